@@ -62,6 +62,8 @@ ctResults ctAuditionEditor::Startup() {
    RegisterModule((ctModuleBase*)Engine->JobSystem);
    RegisterModule((ctModuleBase*)Engine->OSEventManager);
    RegisterModule((ctModuleBase*)Engine->Animation);
+   RegisterModule((ctModuleBase*)Engine->ReadService);
+   RegisterModule((ctModuleBase*)Engine->MemoryProfiler);
    RegisterModule((ctModuleBase*)Engine->Renderer);
    RegisterModule((ctModuleBase*)Engine->Physics);
    RegisterModule((ctModuleBase*)Engine->SceneEngine);
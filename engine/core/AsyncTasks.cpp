@@ -15,7 +15,10 @@
 */
 
 #include "core/EngineCore.hpp"
+#include "core/Settings.hpp"
 #include "AsyncTasks.hpp"
+#include "system/System.h"
+#include "utilities/FrameArena.hpp"
 
 ctAsyncManager* gSharedAsync = NULL;
 
@@ -25,6 +28,13 @@ ctAsyncManager* ctGetAsyncManager() {
 
 ctAsyncManager::ctAsyncManager(bool shared) {
    if (shared) { gSharedAsync = this; }
+   taskLock = ctMutexCreate();
+   taskReady = ctConditionalCreate();
+   taskFinished = ctConditionalCreate();
+   outstandingTasks = 0;
+   wantsExit = false;
+   threadCount = 2;
+   affinityGeneration = 0;
 }
 
 int ctAsyncWorker(void* data) {
@@ -35,18 +45,71 @@ int ctAsyncWorker(void* data) {
 
 ctResults ctAsyncManager::Startup() {
    ZoneScoped;
-   taskLock = ctMutexCreate();
-   stateLock = ctMutexCreate();
-   asyncThread = ctThreadCreate(ctAsyncWorker, this, "ctAsyncTasks");
-   return CT_SUCCESS;
+   ctSettingsSection* settings = Engine->Settings->CreateSection("AsyncTasks", 1);
+   settings->BindInteger(&threadCount,
+                         true,
+                         true,
+                         "ThreadCount",
+                         "Number of threads used for file IO and long running tasks.",
+                         1,
+                         64);
+   return SpawnThreads(threadCount);
 }
 
 ctResults ctAsyncManager::Shutdown() {
    ZoneScoped;
-   ctThreadWaitForExit(asyncThread);
+   JoinThreads();
+   return CT_SUCCESS;
+}
+
+ctResults ctAsyncManager::SpawnThreads(int32_t count) {
+   ZoneScoped;
+   ctAssert(asyncThreads.isEmpty());
+   if (count <= 0) { return CT_FAILURE_INVALID_PARAMETER; }
+   ctMutexLock(taskLock);
+   wantsExit = false;
+   ctMutexUnlock(taskLock);
+   for (int32_t i = 0; i < count; i++) {
+      asyncThreads.Append(ctThreadCreate(ctAsyncWorker, this, "ctAsyncTasks"));
+   }
+   return CT_SUCCESS;
+}
+
+void ctAsyncManager::JoinThreads() {
+   ZoneScoped;
+   ctMutexLock(taskLock);
+   wantsExit = true;
+   ctConditionalSignalAll(taskReady);
+   ctMutexUnlock(taskLock);
+   for (size_t i = 0; i < asyncThreads.Count(); i++) {
+      ctThreadWaitForExit(asyncThreads[i]);
+   }
+   asyncThreads.Clear();
+
+   /* nothing is left to run what is still queued, fail it so waits don't hang */
+   ctMutexLock(taskLock);
+   for (size_t i = 0; i < buckets.Count(); i++) {
+      TaskInternal task;
+      while (buckets[i]->tasks.PopFront(task)) {
+         FinishTask(task.handle, CT_FAILURE_SKIPPED);
+      }
+   }
+   while (!continuations.isEmpty()) {
+      const ctAsyncTaskHandle handle = continuations[0].task.handle;
+      continuations.RemoveAt(0);
+      FinishTask(handle, CT_FAILURE_DEPENDENCY_NOT_MET);
+   }
+   ctMutexUnlock(taskLock);
+}
+
+ctAsyncManager::~ctAsyncManager() {
+   JoinThreads();
+   for (size_t i = 0; i < buckets.Count(); i++) {
+      delete buckets[i];
+   }
+   ctConditionalDestroy(taskFinished);
+   ctConditionalDestroy(taskReady);
    ctMutexDestroy(taskLock);
-   ctMutexDestroy(stateLock);
-   return ctResults();
 }
 
 const char* ctAsyncManager::GetModuleName() {
@@ -58,83 +121,289 @@ ctAsyncTaskHandle ctAsyncManager::CreateTask(const char* name,
                                              void* userdata,
                                              int32_t priority) {
    ZoneScoped;
-   ctMutexLock(stateLock);
-   ctAsyncTaskHandle hndl = handleManager.GetNewHandle();
-   states.Insert(hndl, TaskState());
-   ctMutexUnlock(stateLock);
-
    TaskInternal newTask = TaskInternal();
-   newTask.priority = priority;
    strncpy(newTask.name, name, 32);
    newTask.data = userdata;
    newTask.fn = fpTask;
-   newTask.handle = hndl;
+
    ctMutexLock(taskLock);
-   activeTasks.Append(newTask);
-   activeTasks.QSort(TaskInternal::Compare);
+   ctAsyncTaskHandle hndl = handleManager.GetNewHandle();
+   states.Insert(hndl, TaskState());
+   newTask.handle = hndl;
+   GetBucket(priority)->tasks.Append(newTask);
+   outstandingTasks++;
+   ctConditionalSignalOne(taskReady);
    ctMutexUnlock(taskLock);
    return hndl;
 }
 
 bool ctAsyncManager::isFinished(ctAsyncTaskHandle handle, ctResults* pResultsOut) {
    bool finished = true; /* it isn't there so return true to avoid blockage */
-   ctMutexLock(stateLock);
+   ctMutexLock(taskLock);
    TaskState* pTaskState = states.FindPtr(handle);
    if (pTaskState) {
       if (pResultsOut) { *pResultsOut = pTaskState->results; }
       finished = pTaskState->complete;
    }
-   ctMutexUnlock(stateLock);
+   ctMutexUnlock(taskLock);
    return finished;
 }
 
+ctResults ctAsyncManager::Wait(ctAsyncTaskHandle handle,
+                               int32_t timeoutMs,
+                               ctResults* pResultsOut) {
+   ZoneScoped;
+   const uint64_t start = ctGetTimestamp();
+   ctResults waitResults = CT_SUCCESS;
+   ctMutexLock(taskLock);
+   TaskState* pTaskState = states.FindPtr(handle);
+   while (pTaskState && !pTaskState->complete) {
+      if (timeoutMs < 0) {
+         ctConditionalWait(taskFinished, taskLock);
+      } else {
+         const uint64_t elapsed = ctGetTimestamp() - start;
+         if (elapsed >= (uint64_t)timeoutMs) {
+            waitResults = CT_FAILURE_NOT_FINISHED;
+            break;
+         }
+         ctConditionalWaitTimeout(
+           taskFinished, taskLock, (uint32_t)((uint64_t)timeoutMs - elapsed));
+      }
+      /* the table may have grown while unlocked */
+      pTaskState = states.FindPtr(handle);
+   }
+   if (pTaskState && pResultsOut) { *pResultsOut = pTaskState->results; }
+   ctMutexUnlock(taskLock);
+   return waitResults;
+}
+
+void ctAsyncManager::OnComplete(ctAsyncTaskHandle handle,
+                                ctAsyncCompletionFunction fpCallback,
+                                void* userdata) {
+   ZoneScoped;
+   CompletionInternal completion = CompletionInternal();
+   completion.handle = handle;
+   completion.fn = fpCallback;
+   completion.data = userdata;
+   completion.results = CT_SUCCESS;
+   ctMutexLock(taskLock);
+   TaskState* pTaskState = states.FindPtr(handle);
+   if (pTaskState && !pTaskState->complete) {
+      waitingCompletions.Append(completion);
+   } else {
+      if (pTaskState) { completion.results = pTaskState->results; }
+      readyCompletions.Append(completion);
+   }
+   ctMutexUnlock(taskLock);
+}
+
+ctAsyncTaskHandle ctAsyncManager::Then(ctAsyncTaskHandle parent,
+                                       const char* name,
+                                       ctAsyncTaskFunction fpTask,
+                                       void* userdata,
+                                       int32_t priority) {
+   ZoneScoped;
+   ContinuationInternal continuation = ContinuationInternal();
+   continuation.parent = parent;
+   continuation.priority = priority;
+   strncpy(continuation.task.name, name, 32);
+   continuation.task.data = userdata;
+   continuation.task.fn = fpTask;
+
+   ctMutexLock(taskLock);
+   ctAsyncTaskHandle hndl = handleManager.GetNewHandle();
+   states.Insert(hndl, TaskState());
+   continuation.task.handle = hndl;
+   outstandingTasks++;
+   TaskState* pParentState = states.FindPtr(parent);
+   if (pParentState && !pParentState->complete) {
+      continuations.Append(continuation);
+   } else if (!pParentState || pParentState->results == CT_SUCCESS) {
+      GetBucket(priority)->tasks.Append(continuation.task);
+      ctConditionalSignalOne(taskReady);
+   } else {
+      FinishTask(hndl, CT_FAILURE_DEPENDENCY_NOT_MET);
+   }
+   ctMutexUnlock(taskLock);
+   return hndl;
+}
+
+void ctAsyncManager::DispatchCompletions() {
+   ZoneScoped;
+   ctDynamicArray<CompletionInternal> dispatch;
+   ctMutexLock(taskLock);
+   if (readyCompletions.isEmpty()) {
+      ctMutexUnlock(taskLock);
+      return;
+   }
+   dispatch.Append(readyCompletions.Data(), readyCompletions.Count());
+   readyCompletions.Clear();
+   ctMutexUnlock(taskLock);
+   /* unlocked so callbacks can create and chain more tasks */
+   for (size_t i = 0; i < dispatch.Count(); i++) {
+      dispatch[i].fn(dispatch[i].handle, dispatch[i].results, dispatch[i].data);
+   }
+}
+
+void ctAsyncManager::FinishTask(ctAsyncTaskHandle handle, ctResults results) {
+   TaskState* pTaskState = states.FindPtr(handle);
+   if (pTaskState) {
+      pTaskState->complete = true;
+      pTaskState->results = results;
+   }
+   for (size_t i = 0; i < waitingCompletions.Count(); i++) {
+      if (waitingCompletions[i].handle != handle) { continue; }
+      waitingCompletions[i].results = results;
+      readyCompletions.Append(waitingCompletions[i]);
+      waitingCompletions.RemoveAt(i);
+      i--;
+   }
+   ctDynamicArray<TaskInternal> released;
+   for (size_t i = 0; i < continuations.Count(); i++) {
+      if (continuations[i].parent != handle) { continue; }
+      if (results == CT_SUCCESS) {
+         GetBucket(continuations[i].priority)->tasks.Append(continuations[i].task);
+         ctConditionalSignalOne(taskReady);
+      } else {
+         released.Append(continuations[i].task);
+      }
+      continuations.RemoveAt(i);
+      i--;
+   }
+   /* failures carry down the rest of the chain */
+   for (size_t i = 0; i < released.Count(); i++) {
+      FinishTask(released[i].handle, CT_FAILURE_DEPENDENCY_NOT_MET);
+   }
+   outstandingTasks--;
+   ctConditionalSignalAll(taskFinished);
+}
+
+void ctAsyncManager::WaitForAllToExit() {
+   ZoneScoped;
+   ctMutexLock(taskLock);
+   while (outstandingTasks > 0) {
+      ctConditionalWait(taskFinished, taskLock);
+   }
+   ctMutexUnlock(taskLock);
+}
+
 bool ctAsyncManager::isEmpty() {
-   ctMutexLock(stateLock);
-   bool result = activeTasks.isEmpty();
-   ctMutexUnlock(stateLock);
+   ctMutexLock(taskLock);
+   bool result = outstandingTasks == 0;
+   ctMutexUnlock(taskLock);
    return result;
 }
 
 void ctAsyncManager::ReleaseTask(ctHandle handle) {
-   ctMutexLock(stateLock);
+   ctMutexLock(taskLock);
    handleManager.FreeHandle(handle);
    states.Remove(handle);
-   ctMutexUnlock(stateLock);
+   ctMutexUnlock(taskLock);
+}
+
+void ctAsyncManager::SetPriorityConcurrency(int32_t priority, int32_t maxConcurrent) {
+   ctMutexLock(taskLock);
+   GetBucket(priority)->maxConcurrent = maxConcurrent > 0 ? maxConcurrent : 0;
+   /* raising a cap can make waiting tasks runnable */
+   ctConditionalSignalAll(taskReady);
+   ctMutexUnlock(taskLock);
+}
+
+void ctAsyncManager::SetThreadAffinity(const int32_t* pLogicalProcessors, size_t count) {
+   ctMutexLock(taskLock);
+   pendingAffinity.Clear();
+   pendingAffinity.Append(pLogicalProcessors, count);
+   affinityGeneration++;
+   ctConditionalSignalAll(taskReady);
+   ctMutexUnlock(taskLock);
+}
+
+ctAsyncManager::BucketInternal* ctAsyncManager::GetBucket(int32_t priority) {
+   /* only a handful of distinct priorities are ever used */
+   size_t idx = 0;
+   for (; idx < buckets.Count(); idx++) {
+      if (buckets[idx]->priority == priority) { return buckets[idx]; }
+      if (buckets[idx]->priority < priority) { break; }
+   }
+   BucketInternal* pBucket = new BucketInternal();
+   pBucket->priority = priority;
+   pBucket->maxConcurrent = 0;
+   pBucket->running = 0;
+   buckets.Insert(pBucket, idx);
+   return pBucket;
+}
+
+bool ctAsyncManager::PopTask(TaskInternal& task, BucketInternal*& pBucket) {
+   for (size_t i = 0; i < buckets.Count(); i++) {
+      BucketInternal* pCurrent = buckets[i];
+      if (pCurrent->tasks.isEmpty()) { continue; }
+      if (pCurrent->maxConcurrent && pCurrent->running >= pCurrent->maxConcurrent) {
+         continue;
+      }
+      pCurrent->tasks.PopFront(task);
+      pCurrent->running++;
+      pBucket = pCurrent;
+      return true;
+   }
+   return false;
 }
 
 int ctAsyncManager::RunAsyncLoop() {
-   while (!Engine->isExitRequested()) {
-      TaskInternal nextTask;
-      ctMutexLock(taskLock);
-      if (activeTasks.isEmpty()) {
-         ctMutexUnlock(taskLock);
-         ctWait(1);
+   int32_t appliedAffinity = 0;
+   ctMutexLock(taskLock);
+   while (!wantsExit) {
+      if (appliedAffinity != affinityGeneration) {
+         appliedAffinity = affinityGeneration;
+         ctSystemSetThreadAffinity((const int*)pendingAffinity.Data(),
+                                   (int)pendingAffinity.Count());
+      }
+      TaskInternal task;
+      BucketInternal* pBucket = NULL;
+      if (!PopTask(task, pBucket)) {
+         ctConditionalWait(taskReady, taskLock);
          continue;
       }
-      nextTask = activeTasks[0];
-      activeTasks.RemoveAt(0);
+      runningTasks.Append(task);
       ctMutexUnlock(taskLock);
-      ctResults results = nextTask.fn(nextTask.data);
-      ctMutexLock(stateLock);
-      TaskState* pTaskState = states.FindPtr(nextTask.handle);
-      if (pTaskState) {
-         pTaskState->complete = true;
-         pTaskState->results = results;
+      ctResults results = task.fn(task.data);
+      ctFrameArenaResetThread();
+      ctMutexLock(taskLock);
+      for (size_t i = 0; i < runningTasks.Count(); i++) {
+         if (runningTasks[i].handle == task.handle) {
+            runningTasks.RemoveAt(i);
+            break;
+         }
       }
-      ctMutexUnlock(stateLock);
+      pBucket->running--;
+      /* a capped priority may have room again */
+      if (pBucket->maxConcurrent) { ctConditionalSignalAll(taskReady); }
+      FinishTask(task.handle, results);
    }
+   ctMutexUnlock(taskLock);
    return 0;
 }
 
+#if CITRUS_IMGUI
 #include "imgui/imgui.h"
+#endif
 void ctAsyncManager::DebugUI(bool useGizmos) {
+#if CITRUS_IMGUI
    ctMutexLock(taskLock);
-   for (int i = 0; i < activeTasks.Count(); i++) {
-      ImGui::Text("%.*s", 32, activeTasks[i].name);
+   ImGui::Text("Threads: %d Outstanding: %d Chained: %d",
+               (int)asyncThreads.Count(),
+               outstandingTasks,
+               (int)continuations.Count());
+   for (size_t i = 0; i < buckets.Count(); i++) {
+      const BucketInternal* pBucket = buckets[i];
+      if (pBucket->tasks.isEmpty() && !pBucket->running) { continue; }
+      ImGui::Text("Priority %d: %d running, %d queued",
+                  pBucket->priority,
+                  pBucket->running,
+                  (int)pBucket->tasks.Count());
+   }
+   for (size_t i = 0; i < runningTasks.Count(); i++) {
+      ImGui::Text("%.*s", 32, runningTasks[i].name);
    }
    ctMutexUnlock(taskLock);
-}
-
-int ctAsyncManager::TaskInternal::Compare(const TaskInternal* A, const TaskInternal* B) {
-   return A->priority - B->priority;
+#endif
 }
@@ -17,18 +17,31 @@
 #pragma once
 
 #include "utilities/Common.h"
+#include "utilities/RingBuffer.hpp"
 #include "core/ModuleBase.hpp"
 
 typedef ctHandle ctAsyncTaskHandle;
 typedef ctResults (*ctAsyncTaskFunction)(void* userData);
+typedef void (*ctAsyncCompletionFunction)(ctAsyncTaskHandle handle,
+                                          ctResults results,
+                                          void* userData);
 
 /*
  * Mainly used for file IO/long running tasks
  * You likely should use the job system instead
+ *
+ * Tasks run on a small pool of threads, higher priorities go first and tasks of the
+ * same priority run in the order they were created.
+ * Each priority can be capped to a number of tasks running at once.
+ *
+ * Rather than polling isFinished(), block on a task with Wait(), get notified on the
+ * main thread with OnComplete() or chain the next stage of work with Then().
+ * Handles should only be released once their task has finished.
  */
 class CT_API ctAsyncManager : public ctModuleBase {
 public:
    ctAsyncManager(bool shared = false);
+   ~ctAsyncManager();
    virtual ctResults Startup();
    virtual ctResults Shutdown();
    virtual const char* GetModuleName();
@@ -37,37 +50,97 @@ public:
    ctAsyncTaskHandle
    CreateTask(const char* name, ctAsyncTaskFunction fpTask, void* userdata, int32_t priority);
    bool isFinished(ctAsyncTaskHandle handle, ctResults* pResultsOut = NULL);
-   inline void WaitForAllToExit() {
-      while (!isEmpty()) {}
-   }
+   /* Blocks until the task has finished or timeoutMs passed (-1: no timeout)
+    Returns CT_FAILURE_NOT_FINISHED if it timed out */
+   ctResults
+   Wait(ctAsyncTaskHandle handle, int32_t timeoutMs = -1, ctResults* pResultsOut = NULL);
+   /* fpCallback runs from DispatchCompletions() once the task has finished */
+   void OnComplete(ctAsyncTaskHandle handle,
+                   ctAsyncCompletionFunction fpCallback,
+                   void* userdata);
+   /* Creates a task that is only queued once parent finished successfully
+    If the parent fails it completes with CT_FAILURE_DEPENDENCY_NOT_MET instead */
+   ctAsyncTaskHandle Then(ctAsyncTaskHandle parent,
+                          const char* name,
+                          ctAsyncTaskFunction fpTask,
+                          void* userdata,
+                          int32_t priority);
+   /* Runs the callbacks of finished tasks (called by the engine every frame) */
+   void DispatchCompletions();
+   /* Blocks until every created task has finished running */
+   void WaitForAllToExit();
    bool isEmpty();
    void ReleaseTask(ctHandle handle);
 
+   /* Limit how many tasks of a priority can run at once (0: no limit) */
+   void SetPriorityConcurrency(int32_t priority, int32_t maxConcurrent);
+
+   /* Start/stop the task threads directly (called by Startup/Shutdown)
+    Tasks still queued when the threads stop finish with CT_FAILURE_SKIPPED */
+   ctResults SpawnThreads(int32_t count);
+   void JoinThreads();
+
    int RunAsyncLoop();
 
+   /* Applied by every async thread itself before its next task */
+   void SetThreadAffinity(const int32_t* pLogicalProcessors, size_t count);
 
 protected:
    ctHandleManager handleManager;
 
    struct TaskInternal {
-      static int Compare(const TaskInternal* A, const TaskInternal* B);
-      int32_t priority;
       ctAsyncTaskHandle handle;
       ctAsyncTaskFunction fn;
       void* data;
       char name[32];
    };
-   ctDynamicArray<TaskInternal> activeTasks;
+   /* tasks of a single priority, sorted from highest to lowest */
+   struct BucketInternal {
+      int32_t priority;
+      int32_t maxConcurrent;
+      int32_t running;
+      ctRingBuffer<TaskInternal> tasks;
+   };
+   ctDynamicArray<BucketInternal*> buckets;
+   ctDynamicArray<TaskInternal> runningTasks;
+   BucketInternal* GetBucket(int32_t priority);
+   bool PopTask(TaskInternal& task, BucketInternal*& pBucket);
+
+   /* tasks waiting on another to finish */
+   struct ContinuationInternal {
+      ctAsyncTaskHandle parent;
+      int32_t priority;
+      TaskInternal task;
+   };
+   ctDynamicArray<ContinuationInternal> continuations;
+   struct CompletionInternal {
+      ctAsyncTaskHandle handle;
+      ctAsyncCompletionFunction fn;
+      void* data;
+      ctResults results;
+   };
+   ctDynamicArray<CompletionInternal> waitingCompletions;
+   ctDynamicArray<CompletionInternal> readyCompletions;
+   void FinishTask(ctAsyncTaskHandle handle, ctResults results);
+
+   /* everything below is protected by taskLock */
    ctMutex taskLock;
+   ctConditional taskReady;
+   ctConditional taskFinished;
+   int32_t outstandingTasks;
+   bool wantsExit;
 
    struct TaskState {
       bool complete;
       ctResults results;
    };
    ctHashTable<TaskState, ctAsyncTaskHandle> states;
-   ctMutex stateLock;
 
-   ctThread asyncThread;
+   int32_t threadCount;
+   ctDynamicArray<ctThread> asyncThreads;
+
+   ctDynamicArray<int32_t> pendingAffinity;
+   int32_t affinityGeneration;
 };
 
 ctAsyncManager* ctGetAsyncManager();
\ No newline at end of file
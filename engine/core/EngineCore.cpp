@@ -20,6 +20,7 @@
 #include "GameLayer.hpp"
 
 #include "AsyncTasks.hpp"
+#include "ReadService.hpp"
 #include "JobSystem.hpp"
 #include "FileSystem.hpp"
 #include "Logging.hpp"
@@ -27,6 +28,8 @@
 #include "WindowManager.hpp"
 #include "OSEvents.hpp"
 #include "Translation.hpp"
+#include "MemoryProfiler.hpp"
+#include "utilities/FrameArena.hpp"
 
 #include "middleware/ImguiIntegration.hpp"
 #include "middleware/Im3dIntegration.hpp"
@@ -65,11 +68,13 @@ ctResults ctEngineCore::Ignite(ctApplication* pApp, int argc, char* argv[]) {
    FileSystem = new ctFileSystem(App->GetAppName(), App->GetAppDeveloperName());
    Settings = new ctSettingsManager(argc, argv);
    Debug = new ctDebugSystem(32, true);
+   MemoryProfiler = new ctMemoryProfiler();
 #if CITRUS_INCLUDE_AUDITION
    HotReload = new ctHotReloadDetection();
 #endif
    Translation = new ctTranslation(true);
    AsyncTasks = new ctAsyncManager(true);
+   ReadService = new ctReadService(true);
    JobSystem = new ctJobSystem(2);
    OSEventManager = new ctOSEventManager();
    WindowManager = new ctWindowManager();
@@ -92,34 +97,39 @@ ctResults ctEngineCore::Ignite(ctApplication* pApp, int argc, char* argv[]) {
    Settings->ModuleStartup(this);
    FileSystem->ModuleStartup(this);
    Debug->ModuleStartup(this);
+   MemoryProfiler->ModuleStartup(this);
 #if CITRUS_INCLUDE_AUDITION
-   HotReload->ModuleStartup(this);
-   LiveSync->ModuleStartup(this);
+   HotReload->ModuleStartup(this, CT_MEMORY_TAG_AUDITION);
+   LiveSync->ModuleStartup(this, CT_MEMORY_TAG_AUDITION);
 #endif
    FileSystem->LogPaths();
    Translation->ModuleStartup(this);
    AsyncTasks->ModuleStartup(this);
+   ReadService->ModuleStartup(this, CT_MEMORY_TAG_RESOURCE);
    JobSystem->ModuleStartup(this);
    OSEventManager->ModuleStartup(this);
 #if !CITRUS_HEADLESS
    WindowManager->ModuleStartup(this);
 #endif
-   Interact->ModuleStartup(this);
-   ImguiIntegration->ModuleStartup(this);
-   Im3dIntegration->ModuleStartup(this);
-   Animation->ModuleStartup(this);
-   Physics->ModuleStartup(this);
-   SceneEngine->ModuleStartup(this);
-   Renderer->ModuleStartup(this);
+   Interact->ModuleStartup(this, CT_MEMORY_TAG_INTERACT);
+   ImguiIntegration->ModuleStartup(this, CT_MEMORY_TAG_UI);
+   Im3dIntegration->ModuleStartup(this, CT_MEMORY_TAG_UI);
+   Animation->ModuleStartup(this, CT_MEMORY_TAG_ANIMATION);
+   Physics->ModuleStartup(this, CT_MEMORY_TAG_PHYSICS);
+   SceneEngine->ModuleStartup(this, CT_MEMORY_TAG_SCENE);
+   Renderer->ModuleStartup(this, CT_MEMORY_TAG_RENDERER);
 #if CITRUS_INCLUDE_AUDITION
-   Editor->ModuleStartup(this);
-   AssetCompiler->ModuleStartup(this);
+   Editor->ModuleStartup(this, CT_MEMORY_TAG_AUDITION);
+   AssetCompiler->ModuleStartup(this, CT_MEMORY_TAG_AUDITION);
 #endif
    ctDebugLog("Citrus Toolbox has Started!");
 
    /* Run User Code */
-   GameLayer->ModuleStartup(this);
-   App->OnStartup();
+   GameLayer->ModuleStartup(this, CT_MEMORY_TAG_GAME);
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_GAME);
+      App->OnStartup();
+   }
    ctDebugLog("Application has Started!");
    return CT_SUCCESS;
 }
@@ -145,18 +155,43 @@ bool ctEngineCore::isExitRequested() const {
 
 ctResults ctEngineCore::LoopSingleShot(const float deltatime) {
    ZoneScoped;
+   AsyncTasks->DispatchCompletions();
    Translation->NextFrame();
-   App->OnFrameAdvance(deltatime);
-   SceneEngine->NextFrame(deltatime);
-   App->OnUIUpdate();
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_GAME);
+      App->OnFrameAdvance(deltatime);
+   }
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_SCENE);
+      SceneEngine->NextFrame(deltatime);
+   }
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_UI);
+      App->OnUIUpdate();
+   }
 #if CITRUS_INCLUDE_AUDITION
-   Editor->UpdateEditor();
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_AUDITION);
+      Editor->UpdateEditor();
+   }
 #endif
-   Renderer->RenderFrame();
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_RENDERER);
+      Renderer->RenderFrame();
+   }
    OSEventManager->PollOSEvents();
-   Interact->PumpInput();
-   Im3dIntegration->NextFrame();
-   ImguiIntegration->NextFrame();
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_INTERACT);
+      Interact->PumpInput();
+   }
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_UI);
+      Im3dIntegration->NextFrame();
+      ImguiIntegration->NextFrame();
+   }
+   MemoryProfiler->NextFrame(deltatime);
+   ctFrameArenaResetAll();
+   ctFrameArenaResetThread();
    FrameMark;
    return CT_SUCCESS;
 }
@@ -165,10 +200,14 @@ ctResults ctEngineCore::Shutdown() {
    ZoneScoped;
    /* Kill all dangling tasks first */
    AsyncTasks->ModuleShutdown();
+   ReadService->ModuleShutdown();
 
    /*Shutdown application*/
    ctDebugLog("Application is Shutting Down...");
-   App->OnShutdown();
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_GAME);
+      App->OnShutdown();
+   }
    GameLayer->ModuleShutdown();
 
    /*Shutdown modules*/
@@ -194,6 +233,7 @@ ctResults ctEngineCore::Shutdown() {
 #if CITRUS_INCLUDE_AUDITION
    HotReload->ModuleShutdown();
 #endif
+   MemoryProfiler->ModuleShutdown();
    Debug->ModuleShutdown();
    Settings->ModuleShutdown();
    FileSystem->ModuleShutdown();
@@ -209,12 +249,14 @@ ctResults ctEngineCore::Shutdown() {
    delete ImguiIntegration;
    delete Interact;
    delete WindowManager;
+   delete MemoryProfiler;
    delete Debug;
    delete FileSystem;
    delete Settings;
    delete OSEventManager;
    delete Translation;
    delete JobSystem;
+   delete ReadService;
    delete AsyncTasks;
 #if CITRUS_INCLUDE_AUDITION
    delete HotReload;
@@ -35,6 +35,7 @@ public:
    class ctApplication* App;
    class ctGameLayerManager* GameLayer;
    class ctAsyncManager* AsyncTasks;
+   class ctReadService* ReadService;
    class ctJobSystem* JobSystem;
    class ctOSEventManager* OSEventManager;
    class ctTranslation* Translation;
@@ -47,6 +48,7 @@ public:
    class ctAuditionLiveSync* LiveSync;
 #endif
    class ctDebugSystem* Debug;
+   class ctMemoryProfiler* MemoryProfiler;
    class ctWindowManager* WindowManager;
    class ctInteractionEngine* Interact;
    class ctImguiIntegration* ImguiIntegration;
@@ -17,107 +17,589 @@
 #include "JobSystem.hpp"
 #include "EngineCore.hpp"
 #include "Settings.hpp"
+#include "FileSystem.hpp"
+#include "AsyncTasks.hpp"
+#include "utilities/FrameArena.hpp"
+#include "system/System.h"
+
+#if CITRUS_IMGUI
+#include "imgui/imgui.h"
+#endif
 
 ctJobSystem* gJobSystem = NULL;
 
+/* worker owned by the current thread (can belong to any job system instance) */
+static thread_local void* tpLocalWorker = NULL;
+/* innermost job running on the current thread */
+static thread_local void* tpJobFrame = NULL;
+
 ctJobSystem::ctJobSystem(int32_t _threadReserve, bool shared) {
    if (shared) { gJobSystem = this; }
    threadReserve = _threadReserve;
    threadCount = -1;
-   ctSpinLockInit(jobLock);
+   spinCount = 4096;
+   yieldCount = 64;
+   timelineSize = 0;
+   pinThreads = 0;
+   physicalCoresOnly = 1;
+   isolateAsyncThread = 1;
+   statsStartTick = SDL_GetPerformanceCounter();
+   ctAtomic64Set(externalLockWaitTicks, 0);
+   parkLock = NULL;
+   parkConditional = NULL;
+   ctAtomicSet(sleepingAtom, 0);
+   for (int i = 0; i < CT_JOB_PRIORITY_COUNT; i++) {
+      ctSpinLockInit(lanes[i].injectLock);
+      ctAtomicSet(lanes[i].injectCountAtom, 0);
+      ctAtomic64Set(lanes[i].pushedAtom, 0);
+      ctAtomic64Set(lanes[i].finishedAtom, 0);
+   }
    ctAtomicSet(jobCountAtom, 0);
+   pFreeBatches = NULL;
+   ctSpinLockInit(batchLock);
+   ctSpinLockInit(dependencyNameLock);
+   /* slot 0 is reserved for "no dependency" */
+   dependencyPool.Resize(CT_MAX_JOB_GROUPS);
+   dependencyPool.Memset(0);
+   for (size_t i = 0; i < dependencyPool.Count(); i++) {
+      ctAtomicSet(dependencyPool[i].pending, 0);
+      ctSpinLockInit(dependencyPool[i].lock);
+      dependencyPool[i].pWaiters = NULL;
+   }
 }
 
 int ctJobWorker(void* data) {
    ZoneScoped;
-   ctJobSystem* pJobSystem = (ctJobSystem*)data;
-   pJobSystem->WorkLoop();
+   ctJobSystem::WorkerInternal* pWorker = (ctJobSystem::WorkerInternal*)data;
+   tpLocalWorker = pWorker;
+   if (pWorker->processor >= 0) { ctSystemSetThreadAffinity(&pWorker->processor, 1); }
+   pWorker->pOwner->WorkLoop();
+   tpLocalWorker = NULL;
    return 0;
 }
 
 ctResults ctJobSystem::Startup() {
    ZoneScoped;
-   ctSettingsSection* settings = Engine->Settings->CreateSection("JobSystem", 1);
+   ctSettingsSection* settings = Engine->Settings->CreateSection("JobSystem", 7);
    settings->BindInteger(&threadCount,
                          true,
                          true,
                          "ThreadCount",
                          "Number of threads to use for common jobs. (-1: Auto-select)");
+   settings->BindInteger(&spinCount,
+                         true,
+                         true,
+                         "SpinCount",
+                         "Idle polls before a job thread gives up its timeslice.",
+                         0);
+   settings->BindInteger(&yieldCount,
+                         true,
+                         true,
+                         "YieldCount",
+                         "Idle timeslices given up before a job thread sleeps.",
+                         0);
+   settings->BindInteger(&timelineSize,
+                         true,
+                         true,
+                         "TimelineSize",
+                         "Job events recorded per thread for the timeline. (0: Disabled)",
+                         0);
+   settings->BindInteger(&physicalCoresOnly,
+                         true,
+                         true,
+                         "PhysicalCoresOnly",
+                         "Auto-select one thread per core instead of per SMT thread.",
+                         0,
+                         1);
+   settings->BindInteger(&pinThreads,
+                         true,
+                         true,
+                         "PinThreads",
+                         "Lock the main thread and job threads to their own cores.",
+                         0,
+                         1);
+   settings->BindInteger(&isolateAsyncThread,
+                         true,
+                         true,
+                         "IsolateAsyncThread",
+                         "Keep the async thread off the main thread's core when pinning.",
+                         0,
+                         1);
+
+   ctDynamicArray<ctSystemProcessorInfo> topology;
+   const int logicalCount = ctSystemGetProcessorTopology(NULL, 0);
+   if (logicalCount > 0) {
+      topology.Resize(logicalCount);
+      ctSystemGetProcessorTopology(topology.Data(), logicalCount);
+   }
+   int coreCount = 0;
+   int cacheCount = 0;
+   for (size_t i = 0; i < topology.Count(); i++) {
+      if (topology[i].coreIndex >= coreCount) { coreCount = topology[i].coreIndex + 1; }
+      if (topology[i].cacheIndex >= cacheCount) {
+         cacheCount = topology[i].cacheIndex + 1;
+      }
+   }
 
    int finalThreadCount = 1;
    if (threadCount <= 0) {
-      int coreCount = SDL_GetCPUCount();
-      finalThreadCount = coreCount - threadReserve;
+      int availible = SDL_GetCPUCount();
+      if (physicalCoresOnly && coreCount > 0) { availible = coreCount; }
+      finalThreadCount = availible - threadReserve;
       if (finalThreadCount <= 0) { finalThreadCount = 1; }
    } else {
       finalThreadCount = threadCount;
    }
-   ctAtomicSet(jobCountAtom, 0);
-   ctSpinLockInit(jobLock);
-   threadPool.Reserve(finalThreadCount);
-   jobQueue.Reserve(4096);
-   for (int i = 0; i < finalThreadCount; i++) {
-      ThreadInternal thread = ThreadInternal();
-      thread.thread = ctThreadCreate(ctJobWorker, this, "Job Thread");
-      threadPool.Append(thread);
-   }
-   ctDebugLog("Thread Pool: Reserved %d threads...", finalThreadCount);
+   if (pinThreads && !topology.isEmpty()) {
+      PlanThreadAffinity(topology, finalThreadCount);
+   }
+   CT_RETURN_FAIL(SpawnWorkers(finalThreadCount));
+   ctDebugLog("Thread Pool: Reserved %d threads (%d cores, %d logical, %d caches)...",
+              finalThreadCount,
+              coreCount,
+              logicalCount,
+              cacheCount);
+   if (!threadProcessors.isEmpty()) {
+      char layout[512];
+      int length = snprintf(layout, 512, "host: %d", threadProcessors[0]);
+      for (size_t i = 1; i < threadProcessors.Count(); i++) {
+         if (length <= 0 || length >= 512) { break; }
+         length += snprintf(
+           layout + length, 512 - length, ", %d: %d", (int)i, threadProcessors[i]);
+      }
+      ctDebugLog("Thread Pool: Pinned to logical processors (%s)", layout);
+   }
    return CT_SUCCESS;
 }
 
+struct ctJobProcessorSlot {
+   ctSystemProcessorInfo info;
+   int siblingRank;
+};
+
+/* first thread of every core before any smt siblings, grouped by shared cache */
+static int ctJobProcessorSlotCompare(const ctJobProcessorSlot* A,
+                                     const ctJobProcessorSlot* B) {
+   if (A->siblingRank != B->siblingRank) { return A->siblingRank - B->siblingRank; }
+   if (A->info.cacheIndex != B->info.cacheIndex) {
+      return A->info.cacheIndex - B->info.cacheIndex;
+   }
+   if (A->info.coreIndex != B->info.coreIndex) {
+      return A->info.coreIndex - B->info.coreIndex;
+   }
+   return A->info.logicalIndex - B->info.logicalIndex;
+}
+
+void ctJobSystem::PlanThreadAffinity(ctDynamicArray<ctSystemProcessorInfo>& topology,
+                                     int32_t workerCount) {
+   ZoneScoped;
+   ctDynamicArray<ctJobProcessorSlot> slots;
+   slots.Reserve(topology.Count());
+   for (size_t i = 0; i < topology.Count(); i++) {
+      ctJobProcessorSlot slot;
+      slot.info = topology[i];
+      slot.siblingRank = 0;
+      for (size_t j = 0; j < i; j++) {
+         if (topology[j].coreIndex == topology[i].coreIndex) { slot.siblingRank++; }
+      }
+      slots.Append(slot);
+   }
+   slots.QSort(ctJobProcessorSlotCompare);
+
+   /* the host keeps the first core to itself unless there is nothing else */
+   threadProcessors.Clear();
+   threadProcessors.Append(slots[0].info.logicalIndex);
+   for (int32_t i = 0; i < workerCount; i++) {
+      const size_t slot = slots.Count() > 1 ? 1 + (size_t)i % (slots.Count() - 1) : 0;
+      threadProcessors.Append(slots[slot].info.logicalIndex);
+   }
+
+   if (isolateAsyncThread && Engine && Engine->AsyncTasks) {
+      ctDynamicArray<int32_t> asyncProcessors;
+      for (size_t i = 0; i < topology.Count(); i++) {
+         if (topology[i].coreIndex == slots[0].info.coreIndex) { continue; }
+         asyncProcessors.Append(topology[i].logicalIndex);
+      }
+      if (!asyncProcessors.isEmpty()) {
+         Engine->AsyncTasks->SetThreadAffinity(asyncProcessors.Data(),
+                                               asyncProcessors.Count());
+      }
+   }
+}
+
 ctResults ctJobSystem::Shutdown() {
    ZoneScoped;
-   wantsExit = true;
-   for (int i = 0; i < threadPool.Count(); i++) {
-      ctThreadWaitForExit(threadPool[i].thread);
+   JoinWorkers();
+   return CT_SUCCESS;
+}
+
+ctResults ctJobSystem::SpawnWorkers(int32_t count) {
+   ZoneScoped;
+   ctAssert(workers.isEmpty());
+   if (count <= 0) { return CT_FAILURE_INVALID_PARAMETER; }
+   wantsExit = false;
+   parkLock = ctMutexCreate();
+   parkConditional = ctConditionalCreate();
+   ctAtomicSet(sleepingAtom, 0);
+   ctAtomicSet(jobCountAtom, 0);
+   for (int i = 0; i < CT_JOB_PRIORITY_COUNT; i++) {
+      ctAtomicSet(lanes[i].injectCountAtom, 0);
+      ctSpinLockInit(lanes[i].injectLock);
+      lanes[i].injectQueue.Reserve(1024);
+   }
+
+   /* the calling thread becomes the host and gets a deque of its own */
+   workers.Reserve((size_t)count + 1);
+   for (int32_t i = 0; i <= count; i++) {
+      WorkerInternal* pWorker = new WorkerInternal();
+      pWorker->pOwner = this;
+      pWorker->thread = NULL;
+      pWorker->index = i;
+      pWorker->stealSeed = (uint32_t)i * 2654435761u + 1;
+      pWorker->processor = -1;
+      if ((size_t)i < threadProcessors.Count()) {
+         pWorker->processor = threadProcessors[i];
+      }
+      pWorker->counters = WorkerCounters();
+      pWorker->pTimeline = NULL;
+      pWorker->timelineNext = 0;
+      if (timelineSize > 0) {
+         pWorker->pTimeline =
+           (TimelineEvent*)ctMalloc(sizeof(TimelineEvent) * (size_t)timelineSize);
+      }
+      for (int lane = 0; lane < CT_JOB_PRIORITY_COUNT; lane++) {
+         CT_RETURN_FAIL(pWorker->deques[lane].Reserve(workerDequeCapacity));
+      }
+      workers.Append(pWorker);
+   }
+   tpLocalWorker = workers[0];
+   if (workers[0]->processor >= 0) {
+      ctSystemSetThreadAffinity(&workers[0]->processor, 1);
+   }
+   statsStartTick = SDL_GetPerformanceCounter();
+   for (int32_t i = 1; i <= count; i++) {
+      workers[i]->thread = ctThreadCreate(ctJobWorker, workers[i], "Job Thread");
    }
    return CT_SUCCESS;
 }
 
+void ctJobSystem::JoinWorkers() {
+   ZoneScoped;
+   ctMutexLock(parkLock);
+   wantsExit = true;
+   ctConditionalSignalAll(parkConditional);
+   ctMutexUnlock(parkLock);
+   for (size_t i = 1; i < workers.Count(); i++) {
+      ctThreadWaitForExit(workers[i]->thread);
+   }
+   ctConditionalDestroy(parkConditional);
+   ctMutexDestroy(parkLock);
+   parkConditional = NULL;
+   parkLock = NULL;
+   if (tpLocalWorker && ((WorkerInternal*)tpLocalWorker)->pOwner == this) {
+      tpLocalWorker = NULL;
+   }
+   for (size_t i = 0; i < workers.Count(); i++) {
+      if (workers[i]->pTimeline) { ctFree(workers[i]->pTimeline); }
+      delete workers[i];
+   }
+   workers.Clear();
+   while (pFreeBatches) {
+      DeferredBatch* pNext = pFreeBatches->pNextFree;
+      delete pFreeBatches;
+      pFreeBatches = pNext;
+   }
+}
+
 const char* ctJobSystem::GetModuleName() {
    return "Job System";
 }
 
 ctJobSystemDependency ctJobSystem::DeclareDependency(const char* name) {
-   return ctJobSystemDependency();
-   /* todo*/
+   ZoneScoped;
+   const size_t maxNameLength = sizeof(DependencyInternal::name) - 1;
+   if (strlen(name) > maxNameLength) {
+      ctDebugError("Job System: Dependency name too long %s", name);
+      return 0;
+   }
+   uint32_t hash = ctXXHash32(name);
+   if (hash == 0) { hash = 1; }
+   ctSpinLockEnterCriticalScoped(LOCK, dependencyNameLock);
+   /* different names can share a hash, only the full name identifies one */
+   for (int occurance = 0;; occurance++) {
+      ctJobSystemDependency* pExisting = dependencyNames.FindPtr(hash, occurance);
+      if (!pExisting) { break; }
+      if (strcmp(dependencyPool[*pExisting].name, name) == 0) { return *pExisting; }
+   }
+   const size_t index = dependencyNames.Count() + 1;
+   if (index >= dependencyPool.Count()) {
+      ctDebugError("Job System: Ran out of dependencies declaring %s", name);
+      return 0;
+   }
+   DependencyInternal& dependency = dependencyPool[index];
+   dependency.nameHash = hash;
+   strncpy(dependency.name, name, ctCStaticArrayLen(dependency.name) - 1);
+   dependencyNames.Insert(hash, (ctJobSystemDependency)index);
+   return (ctJobSystemDependency)index;
 }
 
 ctResults ctJobSystem::PushJob(void (*fpFunction)(void*),
                                void* pData,
                                size_t dependencyCount,
-                               ctJobSystemDependency* pDependencies) {
+                               ctJobSystemDependency* pDependencies,
+                               ctJobSystemDependency signalDependency,
+                               ctJobPriority priority) {
    ZoneScoped;
-   return PushJobs(1, &fpFunction, &pData, dependencyCount, pDependencies);
+   return PushJobs(1,
+                   &fpFunction,
+                   &pData,
+                   dependencyCount,
+                   pDependencies,
+                   signalDependency,
+                   priority);
 }
 
 ctResults ctJobSystem::PushJobs(size_t count,
                                 void (**pfpFunction)(void*),
                                 void** ppData,
                                 size_t dependencyCount,
-                                ctJobSystemDependency* pDependencies) {
+                                ctJobSystemDependency* pDependencies,
+                                ctJobSystemDependency signalDependency,
+                                ctJobPriority priority) {
    ZoneScoped;
-   ctSpinLockEnterCritical(jobLock);
-   JobInternal jobBase = JobInternal();
-   ctAssert(dependencyCount <= ctCStaticArrayLen(jobBase.dependencies));
-   for (size_t j = 0; j < dependencyCount; j++) {
-      jobBase.dependencies[j] = pDependencies[j];
+   if (count == 0) { return CT_SUCCESS; }
+   if (priority < 0 || priority >= CT_JOB_PRIORITY_COUNT) {
+      return CT_FAILURE_INVALID_PARAMETER;
    }
-   for (size_t i = 0; i < count; i++) {
-      JobInternal job = jobBase;
-      job.fpFunction = pfpFunction[i];
-      job.pData = ppData[i];
-      jobQueue.Append(job);
-      /* todo: job slot target is last non-empty, else loop to first */
-      /* in practice looping to first should never happen as all will be cleared by a host
-       * call to WaitBarrier() at least once each frame unless dependencyPool saturates */
-   }
-   ctSpinLockExitCritical(jobLock);
+   if (dependencyCount > maxJobDependencies) { return CT_FAILURE_OUT_OF_BOUNDS; }
+   if (signalDependency >= dependencyPool.Count()) {
+      return CT_FAILURE_INVALID_PARAMETER;
+   }
+
+   /* count first so a barrier can't slip past jobs that are about to be visible */
    ctAtomicAdd(jobCountAtom, (int)count);
+   if (signalDependency) {
+      ctAtomicAdd(dependencyPool[signalDependency].pending, (int)count);
+   }
+
+   ctAtomic64Add(lanes[priority].pushedAtom, (int64_t)count);
+   /* fixed stack space no matter how big the batch is */
+   JobInternal jobs[pushChunkSize];
+   for (size_t first = 0; first < count; first += pushChunkSize) {
+      const size_t chunk = count - first < pushChunkSize ? count - first : pushChunkSize;
+      for (size_t i = 0; i < chunk; i++) {
+         jobs[i] = JobInternal();
+         jobs[i].fpFunction = pfpFunction[first + i];
+         jobs[i].pData = ppData[first + i];
+         jobs[i].signal = signalDependency;
+         jobs[i].priority = (uint8_t)priority;
+      }
+      QueueAfterDependencies(jobs, chunk, dependencyCount, pDependencies);
+   }
+   return CT_SUCCESS;
+}
+
+ctResults ctJobSystem::SuspendJob(size_t dependencyCount,
+                                  ctJobSystemDependency* pDependencies) {
+   JobFrame* pFrame = (JobFrame*)tpJobFrame;
+   if (!pFrame || pFrame->pOwner != this) { return CT_FAILURE_NOT_UPDATABLE; }
+   if (!pFrame->pJob->fpFunction) { return CT_FAILURE_NOT_UPDATABLE; }
+   if (dependencyCount > maxJobDependencies) { return CT_FAILURE_OUT_OF_BOUNDS; }
+   for (size_t i = 0; i < dependencyCount; i++) {
+      ctAssert(pDependencies[i] == 0 || pDependencies[i] != pFrame->pJob->signal);
+      pFrame->dependencies[i] = pDependencies[i];
+   }
+   pFrame->dependencyCount = dependencyCount;
+   pFrame->suspended = true;
+   return CT_SUCCESS;
+}
+
+void ctJobSystem::QueueAfterDependencies(const JobInternal* pJobs,
+                                         size_t count,
+                                         size_t dependencyCount,
+                                         ctJobSystemDependency* pDependencies) {
+   if (dependencyCount == 0) {
+      EnqueueJobs(pJobs, count);
+      return;
+   }
+
+   /* hold the jobs back until all dependencies are met */
+   DeferredBatch* pBatch = AllocateBatch();
+   pBatch->jobs.Clear();
+   pBatch->jobs.Reserve(count);
+   for (size_t i = 0; i < count; i++) {
+      pBatch->jobs.Append(pJobs[i]);
+   }
+   /* extra count guards against the batch releasing while still registering */
+   ctAtomicSet(pBatch->remaining, (int)dependencyCount + 1);
+   for (size_t i = 0; i < dependencyCount; i++) {
+      const ctJobSystemDependency target = pDependencies[i];
+      ctAssert(target < dependencyPool.Count());
+      ctAssert(target == 0 || target != pJobs[0].signal); /* would never finish */
+      bool waiting = false;
+      if (target != 0) {
+         DependencyInternal& dependency = dependencyPool[target];
+         WaitLink* pLink = &pBatch->links[i];
+         pLink->pBatch = pBatch;
+         ctSpinLockEnterCritical(dependency.lock);
+         if (ctAtomicGet(dependency.pending) > 0) {
+            pLink->pNext = dependency.pWaiters;
+            dependency.pWaiters = pLink;
+            waiting = true;
+         }
+         ctSpinLockExitCritical(dependency.lock);
+      }
+      if (!waiting) { ctAtomicAdd(pBatch->remaining, -1); }
+   }
+   ReleaseBatch(pBatch);
+}
+
+ctJobLaneStats ctJobSystem::GetLaneStats(ctJobPriority priority) {
+   ctJobLaneStats result = ctJobLaneStats();
+   if (priority < 0 || priority >= CT_JOB_PRIORITY_COUNT) { return result; }
+   LaneInternal& lane = lanes[priority];
+   result.pushed = (uint64_t)ctAtomic64Get(lane.pushedAtom);
+   result.finished = (uint64_t)ctAtomic64Get(lane.finishedAtom);
+   result.queued = (uint64_t)ctAtomicGet(lane.injectCountAtom);
+   for (size_t i = 0; i < workers.Count(); i++) {
+      result.queued += workers[i]->deques[priority].Count();
+   }
+   return result;
+}
+
+ctJobWorkerStats ctJobSystem::GetWorkerStats(size_t workerIndex) {
+   ctJobWorkerStats result = ctJobWorkerStats();
+   if (workerIndex >= workers.Count()) { return result; }
+   const WorkerCounters& counters = workers[workerIndex]->counters;
+   const double frequency = (double)SDL_GetPerformanceFrequency();
+   const uint64_t elapsed = SDL_GetPerformanceCounter() - statsStartTick;
+   result.executed = counters.executed;
+   result.stolen = counters.stolen;
+   result.failedSteals = counters.failedSteals;
+   result.parked = counters.parked;
+   result.busySeconds = (double)counters.busyTicks / frequency;
+   result.lockWaitSeconds = (double)counters.lockWaitTicks / frequency;
+   result.utilization = elapsed ? (double)counters.busyTicks / (double)elapsed : 0.0;
+   if (result.utilization > 1.0) { result.utilization = 1.0; }
+   return result;
+}
+
+void ctJobSystem::ResetStats() {
+   for (size_t i = 0; i < workers.Count(); i++) {
+      workers[i]->counters = WorkerCounters();
+   }
+   for (int i = 0; i < CT_JOB_PRIORITY_COUNT; i++) {
+      ctAtomic64Set(lanes[i].pushedAtom, 0);
+      ctAtomic64Set(lanes[i].finishedAtom, 0);
+   }
+   ctAtomic64Set(externalLockWaitTicks, 0);
+   statsStartTick = SDL_GetPerformanceCounter();
+}
+
+void ctJobSystem::SetTimelineSize(int32_t size) {
+   ctAssert(workers.isEmpty()); /* applied when the workers spawn */
+   timelineSize = size > 0 ? size : 0;
+}
+
+ctResults ctJobSystem::ExportChromeTrace(ctFile& file) {
+   ZoneScoped;
+   if (!file.isOpen()) { return CT_FAILURE_INACCESSIBLE; }
+   const double toMicroseconds = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+   const char* laneNames[] = {"background", "normal", "high"};
+   file.Printf("{\"traceEvents\":[\n");
+   bool first = true;
+   for (size_t i = 0; i < workers.Count(); i++) {
+      const WorkerInternal* pWorker = workers[i];
+      file.Printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                  "\"args\":{\"name\":\"%s %d\"}}",
+                  first ? "" : ",\n",
+                  pWorker->index,
+                  pWorker->index ? "Job Thread" : "Host",
+                  pWorker->index);
+      first = false;
+      if (!pWorker->pTimeline) { continue; }
+      const uint64_t size = (uint64_t)timelineSize;
+      const uint64_t end = pWorker->timelineNext;
+      const uint64_t begin = end > size ? end - size : 0;
+      for (uint64_t e = begin; e < end; e++) {
+         const TimelineEvent& event = pWorker->pTimeline[e % size];
+         if (event.beginTick < statsStartTick) { continue; }
+         file.Printf(",\n{\"name\":\"%p\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,"
+                     "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     event.fpFunction,
+                     laneNames[event.priority],
+                     pWorker->index,
+                     (double)(event.beginTick - statsStartTick) * toMicroseconds,
+                     (double)(event.endTick - event.beginTick) * toMicroseconds);
+      }
+   }
+   file.Printf("\n],\"displayTimeUnit\":\"ms\"}\n");
    return CT_SUCCESS;
 }
 
+void ctJobSystem::DebugUI(bool useGizmos) {
+   DebugImGui();
+}
+
 void ctJobSystem::DebugImGui() {
+#if CITRUS_IMGUI
+   const char* laneNames[] = {"Background", "Normal", "High"};
+   for (int i = CT_JOB_PRIORITY_COUNT - 1; i >= 0; i--) {
+      const ctJobLaneStats lane = GetLaneStats((ctJobPriority)i);
+      ImGui::Text("%s: %" PRIu64 " queued, %" PRIu64 " pushed, %" PRIu64 " finished",
+                  laneNames[i],
+                  lane.queued,
+                  lane.pushed,
+                  lane.finished);
+   }
+   ImGui::Text("External Lock Wait: %.3fms",
+               (double)ctAtomic64Get(externalLockWaitTicks) * 1000.0 /
+                 (double)SDL_GetPerformanceFrequency());
+   if (ImGui::BeginTable("Workers", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("Thread");
+      ImGui::TableSetupColumn("Busy");
+      ImGui::TableSetupColumn("Jobs");
+      ImGui::TableSetupColumn("Stolen");
+      ImGui::TableSetupColumn("Failed Steals");
+      ImGui::TableSetupColumn("Parked");
+      ImGui::TableSetupColumn("Lock Wait");
+      ImGui::TableHeadersRow();
+      for (size_t i = 0; i < workers.Count(); i++) {
+         const ctJobWorkerStats stats = GetWorkerStats(i);
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn();
+         ImGui::Text(i ? "Worker %d" : "Host", (int)i);
+         ImGui::TableNextColumn();
+         ImGui::ProgressBar((float)stats.utilization);
+         ImGui::TableNextColumn();
+         ImGui::Text("%" PRIu64, stats.executed);
+         ImGui::TableNextColumn();
+         ImGui::Text("%" PRIu64, stats.stolen);
+         ImGui::TableNextColumn();
+         ImGui::Text("%" PRIu64, stats.failedSteals);
+         ImGui::TableNextColumn();
+         ImGui::Text("%" PRIu64, stats.parked);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.3fms", stats.lockWaitSeconds * 1000.0);
+      }
+      ImGui::EndTable();
+   }
+   if (ImGui::Button("Reset")) { ResetStats(); }
+   if (timelineSize > 0 && Engine) {
+      ImGui::SameLine();
+      if (ImGui::Button("Export Trace")) {
+         ctFile file;
+         const char* path = "JobTrace.json";
+         if (Engine->FileSystem->OpenPreferencesFile(
+               file, path, CT_FILE_OPEN_WRITE_TEXT) == CT_SUCCESS) {
+            ExportChromeTrace(file);
+            ctDebugLog("Job System: Exported trace to %s", path);
+         }
+      }
+   } else {
+      ImGui::TextDisabled("Set TimelineSize to record a timeline.");
+   }
+#endif
 }
 
 bool ctJobSystem::isExiting() const {
@@ -131,37 +613,312 @@ bool ctJobSystem::isMoreWorkAvailible() {
 
 void ctJobSystem::WaitBarrier() {
    ZoneScoped;
+   /* the calling job counts as unfinished until it returns, it would wait on itself */
+   ctAssert(!tpJobFrame);
    while (isMoreWorkAvailible()) {
-      DoMoreWork();
+      if (!DoMoreWork()) { ctAtomicSpinPause(); }
    }
 }
 
-bool ctJobSystem::DoMoreWork() {
+void ctJobSystem::ParallelFor(size_t begin,
+                              size_t end,
+                              size_t grainSize,
+                              void (*fpFunction)(size_t begin, size_t end, void* pData),
+                              void* pData) {
    ZoneScoped;
-   ctSpinLockEnterCritical(jobLock);
-   if (jobQueue.isEmpty()) {
-      ctSpinLockExitCritical(jobLock);
-      return false;
+   if (begin >= end) { return; }
+   ParallelForInternal parallelFor;
+   parallelFor.fpFunction = fpFunction;
+   parallelFor.pData = pData;
+   parallelFor.grainSize = grainSize;
+   JobFrame* pFrame = (JobFrame*)tpJobFrame;
+   parallelFor.priority = pFrame && pFrame->pOwner == this ? pFrame->pJob->priority
+                                                           : CT_JOB_PRIORITY_NORMAL;
+   if (parallelFor.grainSize == 0) {
+      /* enough pieces for every thread to steal a few times over */
+      const size_t pieces = (GetThreadCount() + 1) * 32;
+      parallelFor.grainSize = (end - begin) / pieces;
+      if (parallelFor.grainSize == 0) { parallelFor.grainSize = 1; }
    }
-   JobInternal job = jobQueue.First();
-   /* todo: factor in dependencies */
-   ctAtomicAdd(jobCountAtom, -1);
-   jobQueue.RemoveFirst();
-   /* todo: fixed job slots which are scanned for sequentially */
-   /* removal will be nullification of function pointer */
-   ctSpinLockExitCritical(jobLock);
-   /* try to lock mutexes or continue */
-   job.fpFunction(job.pData);
-   /* unlock mutexes */
+   ctAtomicSet(parallelFor.pending, 1);
+   RunParallelFor(&parallelFor, begin, end);
+   while (ctAtomicGet(parallelFor.pending) > 0) {
+      if (!DoMoreWork()) { ctAtomicSpinPause(); }
+   }
+}
+
+void ctJobSystem::RunParallelFor(ParallelForInternal* pFor, size_t begin, size_t end) {
+   ZoneScoped;
+   WorkerInternal* pLocal = GetLocalWorker();
+   const size_t grainSize = pFor->grainSize;
+   const uint8_t lane = pFor->priority;
+   const size_t splitDepth =
+     pLocal ? parallelForSplitDepth : GetThreadCount() * parallelForSplitDepth;
+   while (begin < end) {
+      /* lazy binary splitting, only hand out halves while there is nothing to steal */
+      while (end - begin > grainSize) {
+         const size_t queued = pLocal ? pLocal->deques[lane].Count()
+                                      : (size_t)ctAtomicGet(lanes[lane].injectCountAtom);
+         if (queued >= splitDepth) { break; }
+         const size_t middle = begin + (end - begin) / 2;
+         JobInternal job = JobInternal();
+         job.pData = pFor;
+         job.rangeBegin = middle;
+         job.rangeEnd = end;
+         job.priority = lane;
+         ctAtomicAdd(pFor->pending, 1);
+         ctAtomicAdd(jobCountAtom, 1);
+         ctAtomic64Add(lanes[lane].pushedAtom, 1);
+         EnqueueJobs(&job, 1);
+         end = middle;
+      }
+      const size_t stop = end - begin > grainSize ? begin + grainSize : end;
+      pFor->fpFunction(begin, stop, pFor->pData);
+      begin = stop;
+   }
+   /* pFor lives on the caller's stack, it may be gone after this */
+   ctAtomicAdd(pFor->pending, -1);
+}
+
+void ctJobSystem::WaitForDependency(ctJobSystemDependency dependency) {
+   ZoneScoped;
+   while (!isDependencyFinished(dependency)) {
+      if (!DoMoreWork()) { ctAtomicSpinPause(); }
+   }
+}
+
+bool ctJobSystem::isDependencyFinished(ctJobSystemDependency dependency) {
+   if (dependency == 0 || dependency >= dependencyPool.Count()) { return true; }
+   return ctAtomicGet(dependencyPool[dependency].pending) <= 0;
+}
+
+bool ctJobSystem::DoMoreWork() {
+   JobInternal job;
+   if (!AcquireJob(GetLocalWorker(), job)) { return false; }
+   ExecuteJob(job);
    return true;
 }
 
 void ctJobSystem::WorkLoop() {
+   int32_t idleCount = 0;
    while (!isExiting()) {
-      while (isMoreWorkAvailible()) {
-         DoMoreWork();
+      /* between jobs this worker holds no frame memory */
+      ctFrameArenaResetThread();
+      if (DoMoreWork()) {
+         idleCount = 0;
+      } else if (idleCount < spinCount) {
+         ctAtomicSpinPause();
+         idleCount++;
+      } else if (idleCount < spinCount + yieldCount) {
+         ctWait(0);
+         idleCount++;
+      } else {
+         ParkWorker();
+         idleCount = 0;
+      }
+   }
+}
+
+bool ctJobSystem::isWorkQueued() {
+   for (int lane = 0; lane < CT_JOB_PRIORITY_COUNT; lane++) {
+      if (ctAtomicGet(lanes[lane].injectCountAtom) > 0) { return true; }
+      for (size_t i = 0; i < workers.Count(); i++) {
+         if (!workers[i]->deques[lane].isEmpty()) { return true; }
+      }
+   }
+   return false;
+}
+
+void ctJobSystem::ParkWorker() {
+   ZoneScoped;
+   ctMutexLock(parkLock);
+   /* announce before the last look, a pusher either sees us or we see its job */
+   ctAtomicAdd(sleepingAtom, 1);
+   WorkerInternal* pLocal = GetLocalWorker();
+   if (pLocal) { pLocal->counters.parked++; }
+   while (!isExiting() && !isWorkQueued()) {
+      ctConditionalWait(parkConditional, parkLock);
+   }
+   ctAtomicAdd(sleepingAtom, -1);
+   ctMutexUnlock(parkLock);
+}
+
+void ctJobSystem::WakeWorkers(size_t jobCount) {
+   const int sleeping = ctAtomicGet(sleepingAtom);
+   if (sleeping <= 0) { return; }
+   ctMutexLock(parkLock);
+   if (jobCount >= (size_t)sleeping) {
+      ctConditionalSignalAll(parkConditional);
+   } else {
+      for (size_t i = 0; i < jobCount; i++) {
+         ctConditionalSignalOne(parkConditional);
+      }
+   }
+   ctMutexUnlock(parkLock);
+}
+
+ctJobSystem::WorkerInternal* ctJobSystem::GetLocalWorker() {
+   WorkerInternal* pWorker = (WorkerInternal*)tpLocalWorker;
+   if (pWorker && pWorker->pOwner == this) { return pWorker; }
+   return NULL;
+}
+
+void ctJobSystem::EnqueueJobs(const JobInternal* pJobs, size_t count) {
+   WorkerInternal* pLocal = GetLocalWorker();
+   for (size_t i = 0; i < count; i++) {
+      const JobInternal& job = pJobs[i];
+      ctAssert(job.priority < CT_JOB_PRIORITY_COUNT);
+      if (pLocal && pLocal->deques[job.priority].Push(job)) { continue; }
+      /* not a pool thread or the deque is saturated, use the shared queue */
+      LaneInternal& lane = lanes[job.priority];
+      LockInjectQueue(lane, pLocal);
+      lane.injectQueue.Append(job);
+      ctSpinLockExitCritical(lane.injectLock);
+      ctAtomicAdd(lane.injectCountAtom, 1);
+   }
+   WakeWorkers(count);
+}
+
+bool ctJobSystem::AcquireJob(WorkerInternal* pLocal, JobInternal& job) {
+   for (int laneIdx = CT_JOB_PRIORITY_COUNT - 1; laneIdx >= 0; laneIdx--) {
+      /* newest local work first, it is the most likely to be in cache */
+      if (pLocal && pLocal->deques[laneIdx].Pop(job)) { return true; }
+
+      /* work from outside the pool */
+      LaneInternal& lane = lanes[laneIdx];
+      if (ctAtomicGet(lane.injectCountAtom) > 0) {
+         LockInjectQueue(lane, pLocal);
+         const bool found = lane.injectQueue.PopFront(job);
+         ctSpinLockExitCritical(lane.injectLock);
+         if (found) {
+            ctAtomicAdd(lane.injectCountAtom, -1);
+            return true;
+         }
+      }
+      if (StealJob(pLocal, laneIdx, job)) { return true; }
+   }
+   return false;
+}
+
+bool ctJobSystem::StealJob(WorkerInternal* pLocal, int lane, JobInternal& job) {
+   const size_t workerCount = workers.Count();
+   if (workerCount == 0) { return false; }
+   /* start at a random victim so thieves don't pile up on the same deque */
+   size_t start = 0;
+   if (pLocal) {
+      uint32_t x = pLocal->stealSeed;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      pLocal->stealSeed = x;
+      start = x % workerCount;
+   }
+   for (size_t i = 0; i < workerCount; i++) {
+      WorkerInternal* pVictim = workers[(start + i) % workerCount];
+      if (pVictim == pLocal) { continue; }
+      if (pVictim->deques[lane].Steal(job)) {
+         if (pLocal) { pLocal->counters.stolen++; }
+         return true;
+      }
+      if (pLocal) { pLocal->counters.failedSteals++; }
+   }
+   return false;
+}
+
+void ctJobSystem::LockInjectQueue(LaneInternal& lane, WorkerInternal* pLocal) {
+   if (ctSpinLockTryEnterCritical(lane.injectLock)) { return; }
+   const uint64_t start = SDL_GetPerformanceCounter();
+   ctSpinLockEnterCritical(lane.injectLock);
+   const uint64_t waited = SDL_GetPerformanceCounter() - start;
+   if (pLocal) {
+      pLocal->counters.lockWaitTicks += waited;
+   } else {
+      ctAtomic64Add(externalLockWaitTicks, (int64_t)waited);
+   }
+}
+
+void ctJobSystem::ExecuteJob(JobInternal& job) {
+   ZoneScoped;
+   WorkerInternal* pLocal = GetLocalWorker();
+   const uint64_t beginTick = pLocal ? SDL_GetPerformanceCounter() : 0;
+   /* frames nest when a job helps out with other jobs while waiting */
+   JobFrame frame;
+   frame.pOwner = this;
+   frame.pJob = &job;
+   frame.dependencyCount = 0;
+   frame.suspended = false;
+   void* pParentFrame = tpJobFrame;
+   tpJobFrame = &frame;
+   /* a ParallelFor may be gone once its last range finishes, keep what we log */
+   void* fpTimelineFunction = (void*)job.fpFunction;
+   if (job.fpFunction) {
+      job.fpFunction(job.pData);
+   } else {
+      ParallelForInternal* pFor = (ParallelForInternal*)job.pData;
+      fpTimelineFunction = (void*)pFor->fpFunction;
+      RunParallelFor(pFor, job.rangeBegin, job.rangeEnd);
+   }
+   tpJobFrame = pParentFrame;
+   if (pLocal) {
+      /* nested jobs (helping while waiting) count towards both */
+      const uint64_t endTick = SDL_GetPerformanceCounter();
+      pLocal->counters.executed++;
+      pLocal->counters.busyTicks += endTick - beginTick;
+      if (pLocal->pTimeline) {
+         TimelineEvent& event =
+           pLocal->pTimeline[pLocal->timelineNext % (uint64_t)timelineSize];
+         event.beginTick = beginTick;
+         event.endTick = endTick;
+         event.fpFunction = fpTimelineFunction;
+         event.priority = job.priority;
+         pLocal->timelineNext++;
       }
    }
+   if (frame.suspended) {
+      /* still counted and still holding its signal until it runs to completion */
+      QueueAfterDependencies(&job, 1, frame.dependencyCount, frame.dependencies);
+      return;
+   }
+   ctAtomic64Add(lanes[job.priority].finishedAtom, 1);
+   if (job.signal) { SignalDependency(job.signal); }
+   ctAtomicAdd(jobCountAtom, -1);
+}
+
+void ctJobSystem::SignalDependency(ctJobSystemDependency target) {
+   DependencyInternal& dependency = dependencyPool[target];
+   if (ctAtomicAdd(dependency.pending, -1) != 1) { return; }
+   /* another push may have revived the counter before we got the lock */
+   WaitLink* pLink = NULL;
+   ctSpinLockEnterCritical(dependency.lock);
+   if (ctAtomicGet(dependency.pending) == 0) {
+      pLink = dependency.pWaiters;
+      dependency.pWaiters = NULL;
+   }
+   ctSpinLockExitCritical(dependency.lock);
+   while (pLink) {
+      WaitLink* pNext = pLink->pNext;
+      ReleaseBatch(pLink->pBatch);
+      pLink = pNext;
+   }
+}
+
+ctJobSystem::DeferredBatch* ctJobSystem::AllocateBatch() {
+   ctSpinLockEnterCritical(batchLock);
+   DeferredBatch* pBatch = pFreeBatches;
+   if (pBatch) { pFreeBatches = pBatch->pNextFree; }
+   ctSpinLockExitCritical(batchLock);
+   if (!pBatch) { pBatch = new DeferredBatch(); }
+   pBatch->pNextFree = NULL;
+   return pBatch;
+}
+
+void ctJobSystem::ReleaseBatch(DeferredBatch* pBatch) {
+   if (ctAtomicAdd(pBatch->remaining, -1) != 1) { return; }
+   EnqueueJobs(pBatch->jobs.Data(), pBatch->jobs.Count());
+   ctSpinLockEnterCritical(batchLock);
+   pBatch->pNextFree = pFreeBatches;
+   pFreeBatches = pBatch;
+   ctSpinLockExitCritical(batchLock);
 }
 
 ctJobSystem* ctGetJobSystem() {
@@ -18,10 +18,47 @@
 
 #include "utilities/Common.h"
 #include "utilities/RingBuffer.hpp"
+#include "utilities/WorkStealingDeque.hpp"
 #include "ModuleBase.hpp"
 
+/* 0 is never a valid dependency */
 typedef uint16_t ctJobSystemDependency;
 
+/* Ordered the same as ctResourcePriority so loads can pass theirs straight through */
+enum ctJobPriority {
+   CT_JOB_PRIORITY_BACKGROUND, /* asset builds, transcodes, anything that can slip */
+   CT_JOB_PRIORITY_NORMAL,     /* regular engine work */
+   CT_JOB_PRIORITY_HIGH,       /* frame critical (physics, animation, etc) */
+   CT_JOB_PRIORITY_COUNT
+};
+
+struct ctJobLaneStats {
+   uint64_t pushed;
+   uint64_t finished;
+   uint64_t queued; /* approximate */
+};
+
+/* Approximate while jobs are running, each worker updates its own unsynchronized */
+struct ctJobWorkerStats {
+   uint64_t executed;
+   uint64_t stolen;
+   uint64_t failedSteals;
+   uint64_t parked;
+   double busySeconds;
+   double lockWaitSeconds;
+   double utilization; /* busy time since the last reset (0-1) */
+};
+
+/*
+ * Each worker (and the host thread that started the system) owns a work stealing deque.
+ * Jobs pushed from a worker stay on its own deque, idle workers steal from the others.
+ * Jobs pushed from any other thread go through a locked injection queue.
+ * Every priority has its own set of queues, workers always drain higher lanes first.
+ *
+ * Dependencies are counters of unfinished jobs that were pushed with them as a signal.
+ * Jobs that list dependencies are held back until every one of them reaches zero,
+ * then they are queued as a continuation by whichever job finished last.
+ */
 class CT_API ctJobSystem : public ctModuleBase {
 public:
    ctJobSystem(int32_t threadReserve, bool shared = true);
@@ -29,18 +66,64 @@ public:
    ctResults Shutdown() final;
    const char* GetModuleName() final;
 
+   /* Start/stop the worker threads directly (called by Startup/Shutdown) */
+   ctResults SpawnWorkers(int32_t count);
+   void JoinWorkers();
+
+   /* Declaring the same name twice returns the same dependency (31 characters max) */
    ctJobSystemDependency DeclareDependency(const char* name);
+   /* Jobs wait on pDependencies and hold signalDependency until they finish */
    ctResults PushJob(void (*fpFunction)(void*),
                      void* pData,
                      size_t dependencyCount = 0,
-                     ctJobSystemDependency* pDependencies = NULL);
+                     ctJobSystemDependency* pDependencies = NULL,
+                     ctJobSystemDependency signalDependency = 0,
+                     ctJobPriority priority = CT_JOB_PRIORITY_NORMAL);
    ctResults PushJobs(size_t count,
                       void (**pfpFunction)(void*),
                       void** ppData,
                       size_t dependencyCount = 0,
-                      ctJobSystemDependency* pDependencies = NULL);
+                      ctJobSystemDependency* pDependencies = NULL,
+                      ctJobSystemDependency signalDependency = 0,
+                      ctJobPriority priority = CT_JOB_PRIORITY_NORMAL);
+   /* Only valid from inside a running job: once the job function returns it is
+    queued again with the same data after the dependencies finish instead of
+    completing, its signal stays held meanwhile. State that must survive the
+    suspension lives in pData, the job picks up from there when it runs again. */
+   ctResults SuspendJob(size_t dependencyCount, ctJobSystemDependency* pDependencies);
+
+   /* Calls fpFunction over [begin, end) in chunks of at least grainSize (0: auto)
+    Ranges are split in halves on demand while the local queue is starved for work.
+    Splits run in the lane of the job that calls it (normal outside of jobs).
+    Blocks (helping with other jobs) until the whole range has finished. */
+   void ParallelFor(size_t begin,
+                    size_t end,
+                    size_t grainSize,
+                    void (*fpFunction)(size_t begin, size_t end, void* pData),
+                    void* pData);
+   /* fn(size_t begin, size_t end), captures are referenced not copied */
+   template<class Fn>
+   inline void ParallelFor(size_t begin, size_t end, size_t grainSize, const Fn& fn) {
+      ParallelFor(begin, end, grainSize, ParallelForTrampoline<Fn>, (void*)&fn);
+   }
+
+   /* Helps execute jobs until every pushed job has finished
+    Not callable from inside a job, jobs wait on their children with WaitForDependency */
    void WaitBarrier();
+   /* Helps execute jobs until the dependency has no unfinished jobs, works in jobs */
+   void WaitForDependency(ctJobSystemDependency dependency);
+   bool isDependencyFinished(ctJobSystemDependency dependency);
+
+   ctJobLaneStats GetLaneStats(ctJobPriority priority);
+   /* 0 is the host thread, workers are 1-GetThreadCount() */
+   ctJobWorkerStats GetWorkerStats(size_t workerIndex);
+   void ResetStats();
+   /* Keeps the last timelineSize job begin/end events of every worker (0: disabled) */
+   void SetTimelineSize(int32_t timelineSize);
+   /* Chrome trace event JSON (chrome://tracing, Perfetto), call while jobs are idle */
+   ctResults ExportChromeTrace(ctFile& file);
 
+   virtual void DebugUI(bool useGizmos);
    void DebugImGui();
 
    bool isMoreWorkAvailible();
@@ -49,36 +132,163 @@ public:
    void WorkLoop();
 
    inline size_t GetThreadCount() {
-      return threadPool.Count();
+      return workers.isEmpty() ? 0 : workers.Count() - 1;
    }
 
 protected:
    int32_t threadReserve;
    int32_t threadCount;
+   /* idle polls before a worker yields its timeslice, then before it parks */
+   int32_t spinCount;
+   int32_t yieldCount;
+   int32_t timelineSize;
+   int32_t physicalCoresOnly;
+   int32_t pinThreads;
+   int32_t isolateAsyncThread;
+   /* logical processor for each worker when pinned, index 0 is the host */
+   ctDynamicArray<int32_t> threadProcessors;
+   void PlanThreadAffinity(ctDynamicArray<struct ctSystemProcessorInfo>& topology,
+                           int32_t workerCount);
 
+   /* fpFunction is NULL for ParallelFor splits, pData is then the ParallelForInternal */
    struct JobInternal {
       void (*fpFunction)(void*);
       void* pData;
-      uint16_t dependencies[24];
+      size_t rangeBegin;
+      size_t rangeEnd;
+      ctJobSystemDependency signal;
+      uint8_t priority;
    };
-   static_assert(sizeof(JobInternal) == CT_ALIGNMENT_CACHE,
+   static_assert(sizeof(JobInternal) <= CT_ALIGNMENT_CACHE,
                  "JobInternal does not fit cache boundary");
-   ctRingBuffer<JobInternal> jobQueue;
 
-   ctSpinLock jobLock;
+   struct LaneInternal {
+      /* jobs pushed from threads that don't own a deque */
+      ctRingBuffer<JobInternal> injectQueue;
+      ctSpinLock injectLock;
+      ctAtomic injectCountAtom;
+      /* lifetime totals, 32 bits would wrap within hours of heavy use */
+      ctAtomic64 pushedAtom;
+      ctAtomic64 finishedAtom;
+   };
+   LaneInternal lanes[CT_JOB_PRIORITY_COUNT];
+
+   /* pushed but not yet finished */
    ctAtomic jobCountAtom;
 
-   struct ThreadInternal {
+   /* only written by the owning worker */
+   struct WorkerCounters {
+      uint64_t executed;
+      uint64_t stolen;
+      uint64_t failedSteals;
+      uint64_t parked;
+      uint64_t busyTicks;
+      uint64_t lockWaitTicks;
+   };
+   struct TimelineEvent {
+      uint64_t beginTick;
+      uint64_t endTick;
+      void* fpFunction;
+      uint8_t priority;
+   };
+   struct WorkerInternal {
+      ctJobSystem* pOwner;
       ctThread thread;
+      int32_t index;
+      uint32_t stealSeed;
+      int32_t processor; /* -1: unpinned */
+      ctWorkStealingDeque<JobInternal> deques[CT_JOB_PRIORITY_COUNT];
+      WorkerCounters counters;
+      /* ring of the most recent events */
+      TimelineEvent* pTimeline;
+      uint64_t timelineNext;
+   };
+   static const size_t workerDequeCapacity = 4096;
+   /* jobs PushJobs() builds on the stack at once */
+   static const size_t pushChunkSize = 64;
+   /* index 0 is the host thread, workers are 1-N */
+   ctDynamicArray<WorkerInternal*> workers;
+
+   uint64_t statsStartTick;
+   /* spin lock waits from threads outside the pool */
+   ctAtomic64 externalLockWaitTicks;
+   void LockInjectQueue(LaneInternal& lane, WorkerInternal* pLocal);
+
+   WorkerInternal* GetLocalWorker();
+   bool AcquireJob(WorkerInternal* pLocal, JobInternal& job);
+   bool StealJob(WorkerInternal* pLocal, int lane, JobInternal& job);
+   void EnqueueJobs(const JobInternal* pJobs, size_t count);
+   void ExecuteJob(JobInternal& job);
+
+   /* jobs from a single push waiting on their dependencies */
+   static const size_t maxJobDependencies = 16;
+   struct DeferredBatch;
+   struct WaitLink {
+      DeferredBatch* pBatch;
+      WaitLink* pNext;
+   };
+   struct DeferredBatch {
+      ctDynamicArray<JobInternal> jobs;
+      ctAtomic remaining;
+      WaitLink links[maxJobDependencies];
+      DeferredBatch* pNextFree;
+   };
+   DeferredBatch* pFreeBatches;
+   ctSpinLock batchLock;
+   DeferredBatch* AllocateBatch();
+   void ReleaseBatch(DeferredBatch* pBatch);
+
+   void QueueAfterDependencies(const JobInternal* pJobs,
+                               size_t count,
+                               size_t dependencyCount,
+                               ctJobSystemDependency* pDependencies);
+
+   struct JobFrame {
+      ctJobSystem* pOwner;
+      JobInternal* pJob;
+      bool suspended;
+      size_t dependencyCount;
+      ctJobSystemDependency dependencies[maxJobDependencies];
    };
-   ctDynamicArray<ThreadInternal> threadPool;
 
    struct DependencyInternal {
-      ctMutex mutex;
+      ctAtomic pending;
+      ctSpinLock lock;
+      WaitLink* pWaiters;
+      uint32_t nameHash;
+      char name[32];
    };
    ctDynamicArray<DependencyInternal> dependencyPool;
+   ctHashTable<ctJobSystemDependency, uint32_t> dependencyNames;
+   ctSpinLock dependencyNameLock;
+   void SignalDependency(ctJobSystemDependency dependency);
+
+   struct ParallelForInternal {
+      void (*fpFunction)(size_t begin, size_t end, void* pData);
+      void* pData;
+      size_t grainSize;
+      uint8_t priority;
+      ctAtomic pending;
+   };
+   /* queued halves a worker keeps before it stops splitting */
+   static const size_t parallelForSplitDepth = 2;
+   void RunParallelFor(ParallelForInternal* pFor, size_t begin, size_t end);
+   template<class Fn>
+   static void ParallelForTrampoline(size_t begin, size_t end, void* pData) {
+      (*(const Fn*)pData)(begin, end);
+   }
+
+   /* idle workers sleep here until new jobs are queued */
+   ctMutex parkLock;
+   ctConditional parkConditional;
+   ctAtomic sleepingAtom;
+   bool isWorkQueued();
+   void ParkWorker();
+   void WakeWorkers(size_t jobCount);
+
+   volatile bool wantsExit = false;
 
-   bool wantsExit = false;
+   friend int ctJobWorker(void* data);
 };
 
 ctJobSystem* ctGetJobSystem();
\ No newline at end of file
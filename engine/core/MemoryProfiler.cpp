@@ -0,0 +1,155 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "MemoryProfiler.hpp"
+#include "core/EngineCore.hpp"
+#include "core/FileSystem.hpp"
+#include "core/Settings.hpp"
+#include "system/System.h"
+
+ctResults ctMemoryProfiler::Startup() {
+   ZoneScoped;
+   ctSettingsSection* settings = Engine->Settings->CreateSection("MemoryProfiler", 2);
+   settings->BindFloat(&reportInterval,
+                       true,
+                       true,
+                       "ReportInterval",
+                       "Seconds between memory reports (0 disables them).",
+                       0.0f);
+   settings->BindInteger(&reportFormat,
+                         true,
+                         true,
+                         "ReportFormat",
+                         "Memory report format (0: CSV, 1: JSON Lines).",
+                         CT_MEMORY_REPORT_CSV,
+                         CT_MEMORY_REPORT_JSON);
+   return CT_SUCCESS;
+}
+
+ctResults ctMemoryProfiler::Shutdown() {
+   if (reportFile.isOpen()) {
+      WriteReport();
+      reportFile.Close();
+   }
+   return CT_SUCCESS;
+}
+
+const char* ctMemoryProfiler::GetModuleName() {
+   return "Memory Profiler";
+}
+
+void ctMemoryProfiler::NextFrame(float deltaTime) {
+   frameCount++;
+   runTime += deltaTime;
+   if (reportInterval <= 0.0f) { return; }
+   sinceLastReport += deltaTime;
+   if (sinceLastReport < reportInterval) { return; }
+   sinceLastReport = 0.0f;
+   WriteReport();
+}
+
+ctResults ctMemoryProfiler::OpenReportFile() {
+   const char* fileName =
+     reportFormat == CT_MEMORY_REPORT_JSON ? "MemoryReport.jsonl" : "MemoryReport.csv";
+   ctResults result = Engine->FileSystem->OpenPreferencesFile(
+     reportFile, fileName, CT_FILE_OPEN_WRITE_TEXT);
+   if (result != CT_SUCCESS) {
+      ctDebugError("Memory Profiler: %s CANNOT BE OPENED!", fileName);
+      return result;
+   }
+   if (reportFormat == CT_MEMORY_REPORT_CSV) {
+      reportFile.Printf("time,frame,resident,alive,tag,bytes,count,highWater\n");
+   }
+   return CT_SUCCESS;
+}
+
+ctResults ctMemoryProfiler::WriteReport() {
+   ZoneScoped;
+   if (!reportFile.isOpen()) { CT_RETURN_FAIL(OpenReportFile()); }
+   const unsigned long long resident =
+     (unsigned long long)ctSystemGetResidentMemory();
+   const unsigned long long alive = (unsigned long long)ctGetAliveAllocations();
+   if (reportFormat == CT_MEMORY_REPORT_JSON) {
+      reportFile.Printf("{\"time\":%.3f,\"frame\":%" PRIu64
+                        ",\"resident\":%llu,\"alive\":%llu,\"tags\":{",
+                        runTime,
+                        frameCount,
+                        resident,
+                        alive);
+   }
+   for (int i = 0; i < CT_MEMORY_TAG_COUNT; i++) {
+      const ctMemoryTagStats stats = ctMemoryTagGetStats((ctMemoryTag)i);
+      if (reportFormat == CT_MEMORY_REPORT_JSON) {
+         reportFile.Printf(
+           "%s\"%s\":{\"bytes\":%" PRId64 ",\"count\":%" PRId64 ",\"highWater\":%" PRId64
+           "}",
+           i ? "," : "",
+           ctMemoryTagGetName((ctMemoryTag)i),
+           stats.bytes,
+           stats.count,
+           stats.highWater);
+      } else {
+         reportFile.Printf("%.3f,%" PRIu64 ",%llu,%llu,%s,%" PRId64 ",%" PRId64
+                           ",%" PRId64 "\n",
+                           runTime,
+                           frameCount,
+                           resident,
+                           alive,
+                           ctMemoryTagGetName((ctMemoryTag)i),
+                           stats.bytes,
+                           stats.count,
+                           stats.highWater);
+      }
+   }
+   if (reportFormat == CT_MEMORY_REPORT_JSON) { reportFile.Printf("}}\n"); }
+   reportFile.Flush();
+   return CT_SUCCESS;
+}
+
+#if CITRUS_IMGUI
+#include "imgui/imgui.h"
+#endif
+void ctMemoryProfiler::DebugUI(bool useGizmos) {
+#if CITRUS_IMGUI
+   const double toMegabytes = 1.0 / (1024.0 * 1024.0);
+   ImGui::Text("Resident: %.2f MB Alive Allocations: %llu",
+               (double)ctSystemGetResidentMemory() * toMegabytes,
+               (unsigned long long)ctGetAliveAllocations());
+   if (ImGui::BeginTable("Tags", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("Tag");
+      ImGui::TableSetupColumn("Used");
+      ImGui::TableSetupColumn("Allocations");
+      ImGui::TableSetupColumn("High Water");
+      ImGui::TableHeadersRow();
+      for (int i = 0; i < CT_MEMORY_TAG_COUNT; i++) {
+         const ctMemoryTagStats stats = ctMemoryTagGetStats((ctMemoryTag)i);
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn();
+         ImGui::TextUnformatted(ctMemoryTagGetName((ctMemoryTag)i));
+         ImGui::TableNextColumn();
+         ImGui::Text("%.2f MB", (double)stats.bytes * toMegabytes);
+         ImGui::TableNextColumn();
+         ImGui::Text("%" PRId64, stats.count);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.2f MB", (double)stats.highWater * toMegabytes);
+      }
+      ImGui::EndTable();
+   }
+   if (ImGui::Button("Reset High Water")) { ctMemoryTagResetHighWater(); }
+   ImGui::SameLine();
+   if (ImGui::Button("Write Report")) { WriteReport(); }
+#endif
+}
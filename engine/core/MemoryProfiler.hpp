@@ -0,0 +1,51 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "utilities/Common.h"
+#include "core/ModuleBase.hpp"
+
+enum ctMemoryReportFormat {
+   CT_MEMORY_REPORT_CSV,  /* one row per tag per report */
+   CT_MEMORY_REPORT_JSON, /* one object per line per report (JSON Lines) */
+};
+
+/*
+ * Shows the per tag heap usage (see ctMemoryTag) and appends it to a report file
+ * in the preferences folder every ReportInterval seconds for headless runs.
+ */
+class CT_API ctMemoryProfiler : public ctModuleBase {
+public:
+   ctResults Startup() final;
+   ctResults Shutdown() final;
+   const char* GetModuleName() final;
+   virtual void DebugUI(bool useGizmos);
+
+   /* Writes a report whenever the interval has elapsed */
+   void NextFrame(float deltaTime);
+   /* Appends the current usage to the report file */
+   ctResults WriteReport();
+
+protected:
+   float reportInterval = 0.0f;
+   int32_t reportFormat = CT_MEMORY_REPORT_CSV;
+   float sinceLastReport = 0.0f;
+   double runTime = 0.0;
+   uint64_t frameCount = 0;
+   ctFile reportFile;
+   ctResults OpenReportFile();
+};
@@ -15,8 +15,11 @@
    limitations under the License.
 */
 
-ctResults ctModuleBase::ModuleStartup(class ctEngineCore* pEngine) {
+ctResults ctModuleBase::ModuleStartup(class ctEngineCore* pEngine,
+                                     ctMemoryTag memoryTag) {
    Engine = pEngine;
+   _memoryTag = memoryTag;
+   ctMemoryTagScoped(_memoryTag);
    ctResults result = Startup();
    if (result == CT_SUCCESS) { _started = true; }
    return result;
@@ -24,6 +27,7 @@ ctResults ctModuleBase::ModuleStartup(class ctEngineCore* pEngine) {
 
 ctResults ctModuleBase::ModuleShutdown() {
    if (_started) {
+      ctMemoryTagScoped(_memoryTag);
       _started = false;
       return Shutdown();
    }
@@ -34,6 +38,10 @@ bool ctModuleBase::isStarted() const {
    return _started;
 }
 
+ctMemoryTag ctModuleBase::GetMemoryTag() const {
+   return _memoryTag;
+}
+
 #if CITRUS_IMGUI
 #include "imgui/imgui.h"
 #endif
@@ -22,10 +22,13 @@ class CT_API ctModuleBase {
 public:
    virtual ctResults Startup() = 0;
    virtual ctResults Shutdown() = 0;
-   ctResults ModuleStartup(class ctEngineCore* pEngine);
+   /* Allocations made by Startup/Shutdown are charged to memoryTag */
+   ctResults ModuleStartup(class ctEngineCore* pEngine,
+                           ctMemoryTag memoryTag = CT_MEMORY_TAG_CORE);
    ctResults ModuleShutdown();
 
    bool isStarted() const;
+   ctMemoryTag GetMemoryTag() const;
 
    virtual void DebugUI(bool useGizmos);
    virtual const char* GetModuleName() = 0;
@@ -35,4 +38,5 @@ protected:
 
 private:
    bool _started = false;
+   ctMemoryTag _memoryTag = CT_MEMORY_TAG_CORE;
 };
\ No newline at end of file
@@ -0,0 +1,242 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "core/EngineCore.hpp"
+#include "core/Settings.hpp"
+#include "ReadService.hpp"
+#include "system/System.h"
+#include "utilities/FrameArena.hpp"
+
+ctReadService* gSharedReadService = NULL;
+
+ctReadService* ctGetReadService() {
+   return gSharedReadService;
+}
+
+ctReadService::ctReadService(bool shared) {
+   if (shared) { gSharedReadService = this; }
+   queueLock = ctMutexCreate();
+   readReady = ctConditionalCreate();
+   batchFinished = ctConditionalCreate();
+   wantsExit = false;
+   inFlight = 0;
+   bytesRead = 0;
+   readsFinished = 0;
+   threadCount = 4;
+}
+
+ctReadService::~ctReadService() {
+   JoinThreads();
+   ctConditionalDestroy(batchFinished);
+   ctConditionalDestroy(readReady);
+   ctMutexDestroy(queueLock);
+}
+
+int ctReadWorker(void* data) {
+   ZoneScoped;
+   ctReadService* pService = (ctReadService*)data;
+   return pService->RunReadLoop();
+}
+
+ctResults ctReadService::Startup() {
+   ZoneScoped;
+   ctSettingsSection* settings = Engine->Settings->CreateSection("ReadService", 1);
+   settings->BindInteger(&threadCount,
+                         true,
+                         true,
+                         "ThreadCount",
+                         "Number of file reads kept in flight at once.",
+                         1,
+                         64);
+   return SpawnThreads(threadCount);
+}
+
+ctResults ctReadService::Shutdown() {
+   ZoneScoped;
+   JoinThreads();
+   return CT_SUCCESS;
+}
+
+const char* ctReadService::GetModuleName() {
+   return "Read Service";
+}
+
+ctResults ctReadService::SpawnThreads(int32_t count) {
+   ZoneScoped;
+   ctAssert(readThreads.isEmpty());
+   if (count <= 0) { return CT_FAILURE_INVALID_PARAMETER; }
+   ctMutexLock(queueLock);
+   wantsExit = false;
+   ctMutexUnlock(queueLock);
+   for (int32_t i = 0; i < count; i++) {
+      readThreads.Append(ctThreadCreate(ctReadWorker, this, "ctReadService"));
+   }
+   return CT_SUCCESS;
+}
+
+void ctReadService::JoinThreads() {
+   ZoneScoped;
+   ctMutexLock(queueLock);
+   wantsExit = true;
+   ctConditionalSignalAll(readReady);
+   ctMutexUnlock(queueLock);
+   for (size_t i = 0; i < readThreads.Count(); i++) {
+      ctThreadWaitForExit(readThreads[i]);
+   }
+   readThreads.Clear();
+
+   /* nothing is left to read what is still queued, fail it so waits don't hang */
+   ctMutexLock(queueLock);
+   QueuedRead read;
+   while (queue.PopFront(read)) {
+      read.pRequest->result = CT_FAILURE_SKIPPED;
+      ctAtomicAdd(read.pBatch->failures, 1);
+      ctAtomicAdd(read.pBatch->pending, -1);
+   }
+   ctConditionalSignalAll(batchFinished);
+   ctMutexUnlock(queueLock);
+}
+
+ctReadServiceFile ctReadService::OpenFile(const char* path, bool silent) {
+   ZoneScoped;
+   void* handle = ctSystemOpenReadFile(path);
+   if (!handle && !silent) { ctDebugError("COULD NOT OPEN: %s", path); }
+   return handle;
+}
+
+int64_t ctReadService::GetFileSize(ctReadServiceFile file) {
+   if (!file) { return -1; }
+   return ctSystemGetReadFileSize(file);
+}
+
+void ctReadService::CloseFile(ctReadServiceFile file) {
+   ctSystemCloseReadFile(file);
+}
+
+int ctReadService::CompareQueuedRead(const QueuedRead* pA, const QueuedRead* pB) {
+   /* keep reads of the same file in ascending order for the device */
+   const ctReadRequest* pReqA = pA->pRequest;
+   const ctReadRequest* pReqB = pB->pRequest;
+   if (pReqA->file != pReqB->file) { return pReqA->file < pReqB->file ? -1 : 1; }
+   if (pReqA->offset != pReqB->offset) { return pReqA->offset < pReqB->offset ? -1 : 1; }
+   return 0;
+}
+
+ctResults
+ctReadService::Submit(ctReadBatch& batch, ctReadRequest* pRequests, size_t count) {
+   ZoneScoped;
+   if (count == 0) { return CT_SUCCESS; }
+   if (!pRequests) { return CT_FAILURE_INVALID_PARAMETER; }
+   ctDynamicArray<QueuedRead> sorted;
+   sorted.Reserve(count);
+   for (size_t i = 0; i < count; i++) {
+      if (!pRequests[i].file || (!pRequests[i].pDest && pRequests[i].size)) {
+         return CT_FAILURE_INVALID_PARAMETER;
+      }
+      pRequests[i].bytesRead = 0;
+      pRequests[i].result = CT_SUCCESS;
+      sorted.Append({&pRequests[i], &batch});
+   }
+   sorted.QSort(CompareQueuedRead);
+
+   ctMutexLock(queueLock);
+   ctAtomicAdd(batch.pending, (int)count);
+   for (size_t i = 0; i < sorted.Count(); i++) {
+      queue.Append(sorted[i]);
+   }
+   if (count == 1) {
+      ctConditionalSignalOne(readReady);
+   } else {
+      ctConditionalSignalAll(readReady);
+   }
+   ctMutexUnlock(queueLock);
+   return CT_SUCCESS;
+}
+
+bool ctReadService::isFinished(ctReadBatch& batch) {
+   return ctAtomicGet(batch.pending) == 0;
+}
+
+ctResults ctReadService::Wait(ctReadBatch& batch) {
+   ZoneScoped;
+   ctMutexLock(queueLock);
+   while (ctAtomicGet(batch.pending) > 0) {
+      ctConditionalWait(batchFinished, queueLock);
+   }
+   ctMutexUnlock(queueLock);
+   return ctAtomicGet(batch.failures) ? CT_FAILURE_INACCESSIBLE : CT_SUCCESS;
+}
+
+int ctReadService::RunReadLoop() {
+   ctMutexLock(queueLock);
+   while (!wantsExit) {
+      if (queue.isEmpty()) {
+         ctConditionalWait(readReady, queueLock);
+         continue;
+      }
+      QueuedRead read;
+      queue.PopFront(read);
+      inFlight++;
+      ctMutexUnlock(queueLock);
+
+      ctReadRequest* pRequest = read.pRequest;
+      const int64_t result = ctSystemReadFileAt(
+        pRequest->file, pRequest->offset, pRequest->pDest, pRequest->size);
+      if (result < 0) {
+         pRequest->result = CT_FAILURE_INACCESSIBLE;
+      } else {
+         pRequest->bytesRead = (size_t)result;
+         if (pRequest->bytesRead != pRequest->size) {
+            pRequest->result = CT_FAILURE_CORRUPTED_CONTENTS;
+         }
+      }
+      const size_t landed = pRequest->bytesRead;
+      const bool failed = pRequest->result != CT_SUCCESS;
+      if (pRequest->fpOnComplete) {
+         pRequest->fpOnComplete(pRequest, pRequest->pUserData);
+      }
+      ctFrameArenaResetThread();
+
+      ctMutexLock(queueLock);
+      inFlight--;
+      bytesRead += landed;
+      readsFinished++;
+      /* the batch can be gone as soon as pending drops and the lock is released */
+      if (failed) { ctAtomicAdd(read.pBatch->failures, 1); }
+      if (ctAtomicAdd(read.pBatch->pending, -1) == 1) {
+         ctConditionalSignalAll(batchFinished);
+      }
+   }
+   ctMutexUnlock(queueLock);
+   return 0;
+}
+
+#if CITRUS_IMGUI
+#include "imgui/imgui.h"
+#endif
+void ctReadService::DebugUI(bool useGizmos) {
+#if CITRUS_IMGUI
+   ctMutexLock(queueLock);
+   ImGui::Text("Threads: %d In Flight: %d Queued: %d",
+               (int)readThreads.Count(),
+               inFlight,
+               (int)queue.Count());
+   ImGui::Text("Reads: %llu (%.2f MB)",
+               (unsigned long long)readsFinished,
+               (double)bytesRead / (1024.0 * 1024.0));
+   ctMutexUnlock(queueLock);
+#endif
+}
@@ -0,0 +1,104 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "utilities/Common.h"
+#include "utilities/RingBuffer.hpp"
+#include "core/ModuleBase.hpp"
+
+typedef void* ctReadServiceFile;
+
+struct ctReadRequest {
+   ctReadServiceFile file;
+   int64_t offset;
+   size_t size;
+   void* pDest;
+   /* Optional, called on the read thread as soon as this request lands */
+   void (*fpOnComplete)(struct ctReadRequest* pRequest, void* pUserData);
+   void* pUserData;
+   /* Written by the service before fpOnComplete */
+   size_t bytesRead;
+   ctResults result;
+};
+
+/* Owned by the caller, must outlive every request submitted with it */
+struct ctReadBatch {
+   ctReadBatch() {
+      ctAtomicSet(pending, 0);
+      ctAtomicSet(failures, 0);
+   }
+   ctAtomic pending;
+   ctAtomic failures;
+};
+
+/*
+ * Positional file reads serviced by a pool of read threads
+ * Every thread keeps one read in flight, so loaders that submit their reads as a batch
+ * keep the device busy instead of reading a file front to back on one thread.
+ * Requests of a batch finish in any order, work on one can start from its callback
+ * (ex: decompress a section) while the rest of the batch is still being read.
+ */
+class CT_API ctReadService : public ctModuleBase {
+public:
+   ctReadService(bool shared = false);
+   ~ctReadService();
+   ctResults Startup() final;
+   ctResults Shutdown() final;
+   const char* GetModuleName() final;
+   virtual void DebugUI(bool useGizmos);
+
+   /* Start/stop the read threads directly (called by Startup/Shutdown)
+    Requests still queued when the threads stop fail with CT_FAILURE_SKIPPED,
+    their fpOnComplete is not called */
+   ctResults SpawnThreads(int32_t count);
+   void JoinThreads();
+
+   /* Files can be shared by any number of requests, only close them once idle */
+   ctReadServiceFile OpenFile(const char* path, bool silent = false);
+   int64_t GetFileSize(ctReadServiceFile file);
+   void CloseFile(ctReadServiceFile file);
+
+   /* Requests must stay alive and untouched until the batch has finished */
+   ctResults Submit(ctReadBatch& batch, ctReadRequest* pRequests, size_t count);
+   bool isFinished(ctReadBatch& batch);
+   /* Blocks until every request of the batch is done, fails if any of them did */
+   ctResults Wait(ctReadBatch& batch);
+
+   int RunReadLoop();
+
+protected:
+   struct QueuedRead {
+      ctReadRequest* pRequest;
+      ctReadBatch* pBatch;
+   };
+   static int CompareQueuedRead(const QueuedRead* pA, const QueuedRead* pB);
+
+   /* everything below is protected by queueLock */
+   ctMutex queueLock;
+   ctConditional readReady;
+   ctConditional batchFinished;
+   ctRingBuffer<QueuedRead> queue;
+   bool wantsExit;
+   int32_t inFlight;
+   uint64_t bytesRead;
+   uint64_t readsFinished;
+
+   int32_t threadCount;
+   ctDynamicArray<ctThread> readThreads;
+};
+
+ctReadService* ctGetReadService();
@@ -15,6 +15,7 @@
 */
 
 #include "CitrusPackage.h"
+#include "utilities/VirtualArray.hpp"
 
 /* ------------- Write Internals ------------- */
 
@@ -33,7 +34,7 @@ public:
 
 private:
    ctFile file;
-   ctDynamicArray<ctPackageSection> sections;
+   ctVirtualArray<ctPackageSection> sections;
 };
 
 ctResults
@@ -140,8 +141,8 @@ public:
 
 private:
    ctDynamicArray<ctPackageReadMetadata> packages;
-   ctDynamicArray<uint32_t> sectionPackageIndex;
-   ctDynamicArray<ctPackageSection> sections;
+   ctVirtualArray<uint32_t> sectionPackageIndex;
+   ctVirtualArray<ctPackageSection> sections;
 
    ctHashTable<uint32_t, uint64_t> sectionIndexByPathHash;
    ctHashTable<uint32_t, uint64_t> sectionIndexByGUIDHash;
@@ -97,7 +97,7 @@ ctResults ctStartAndRetrieveInteractBackends(
       if (backendEnabled[i]) {
          pBackends[i] = newBackend((ctInteractBackends)i);
          ctAssert(pBackends[i]);
-         pBackends[i]->ModuleStartup(pEngine);
+         pBackends[i]->ModuleStartup(pEngine, CT_MEMORY_TAG_INTERACT);
       }
    }
    ctRetrieveInteractBackends(backendList);
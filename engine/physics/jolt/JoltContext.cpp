@@ -43,7 +43,8 @@ void CitrusJoltAlignedFree(void* ptr) {
 
 /* ------------------- Job System Wrapper ------------------- */
 int CitrusJoltJobSystem::GetMaxConcurrency() const {
-   return (int)ctGetJobSystem()->GetThreadCount();
+   /* the thread waiting on a barrier helps out */
+   return (int)ctGetJobSystem()->GetThreadCount() + 1;
 }
 
 /* similar to JobSystemThreadPool */
@@ -57,8 +58,8 @@ CitrusJoltJobSystem::CreateJob(const char* inJobName,
       index =
         jobs.ConstructObject(inJobName, inColor, this, inJobFunction, inNumDependencies);
       if (index != jobs.cInvalidObjectIndex) break;
-      ctDebugError("No jolt jobs were availible...");
-      ctWait(1);
+      /* finishing queued jobs is what frees up more */
+      if (!ctGetJobSystem()->DoMoreWork()) { ctAtomicSpinPause(); }
    }
    Job* job = &jobs.Get(index);
    JobHandle handle(job);
@@ -66,6 +67,52 @@ CitrusJoltJobSystem::CreateJob(const char* inJobName,
    return handle;
 }
 
+CitrusJoltJobSystem::Barrier* CitrusJoltJobSystem::CreateBarrier() {
+   for (int i = 0; i < maxBarriers; i++) {
+      if (ctAtomicCompareExchange(barriers[i].inUse, 0, 1)) {
+         ctAtomicSet(barriers[i].pending, 0);
+         return &barriers[i];
+      }
+   }
+   ctDebugError("No jolt barriers were availible...");
+   return NULL;
+}
+
+void CitrusJoltJobSystem::DestroyBarrier(Barrier* inBarrier) {
+   CitrusJoltBarrier* pBarrier = (CitrusJoltBarrier*)inBarrier;
+   ctAssert(ctAtomicGet(pBarrier->pending) == 0);
+   ctAtomicSet(pBarrier->inUse, 0);
+}
+
+void CitrusJoltJobSystem::WaitForJobs(Barrier* inBarrier) {
+   ZoneScoped;
+   CitrusJoltBarrier* pBarrier = (CitrusJoltBarrier*)inBarrier;
+   ctJobSystem* pJobSystem = ctGetJobSystem();
+   while (ctAtomicGet(pBarrier->pending) > 0) {
+      if (!pJobSystem->DoMoreWork()) { ctAtomicSpinPause(); }
+   }
+}
+
+void CitrusJoltJobSystem::CitrusJoltBarrier::AddJob(const JobHandle& inJob) {
+   /* count first, the job may finish the moment it knows about the barrier */
+   ctAtomicAdd(pending, 1);
+   if (!inJob.GetPtr()->SetBarrier(this)) { ctAtomicAdd(pending, -1); }
+}
+
+void CitrusJoltJobSystem::CitrusJoltBarrier::AddJobs(const JobHandle* inHandles,
+                                                     JPH::uint inNumHandles) {
+   ctAtomicAdd(pending, (int)inNumHandles);
+   int alreadyDone = 0;
+   for (JPH::uint i = 0; i < inNumHandles; i++) {
+      if (!inHandles[i].GetPtr()->SetBarrier(this)) { alreadyDone++; }
+   }
+   if (alreadyDone) { ctAtomicAdd(pending, -alreadyDone); }
+}
+
+void CitrusJoltJobSystem::CitrusJoltBarrier::OnJobFinished(Job* inJob) {
+   ctAtomicAdd(pending, -1);
+}
+
 void CitrusJoltJobSystem::FreeJob(Job* inJob) {
    jobs.DestructObject(inJob);
 }
@@ -78,13 +125,22 @@ void CitrusJoltJobSystem::ExecuteJob(void* data) {
 
 void CitrusJoltJobSystem::QueueJob(Job* inJob) {
    inJob->AddRef();
-   ctGetJobSystem()->PushJob(ExecuteJob, (void*)inJob);
+   ctGetJobSystem()->PushJob(ExecuteJob, (void*)inJob, 0, NULL, 0, CT_JOB_PRIORITY_HIGH);
 }
 
 void CitrusJoltJobSystem::QueueJobs(Job** inJobs, unsigned int inNumJobs) {
-   /* technically inefficient as we have to acquire the spinlock every iteration */
-   for (unsigned int i = 0; i < inNumJobs; i++) {
-      QueueJob(inJobs[i]);
+   /* one push per chunk, the stack stays small for any batch size */
+   void (*fpFunctions[64])(void*);
+   void* pData[64];
+   for (unsigned int first = 0; first < inNumJobs; first += 64) {
+      const unsigned int chunk = inNumJobs - first < 64 ? inNumJobs - first : 64;
+      for (unsigned int i = 0; i < chunk; i++) {
+         inJobs[first + i]->AddRef();
+         fpFunctions[i] = ExecuteJob;
+         pData[i] = (void*)inJobs[first + i];
+      }
+      ctGetJobSystem()->PushJobs(
+        chunk, fpFunctions, pData, 0, NULL, 0, CT_JOB_PRIORITY_HIGH);
    }
 }
 
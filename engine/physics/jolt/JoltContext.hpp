@@ -30,7 +30,7 @@
 #include "../Physics.hpp"
 
 #include "Jolt/Core/TempAllocator.h"
-#include "Jolt/Core/JobSystemWithBarrier.h"
+#include "Jolt/Core/JobSystem.h"
 #include "Jolt/Core/FixedSizeFreeList.h"
 #include "Jolt/Core/Factory.h"
 #include "Jolt/RegisterTypes.h"
@@ -127,22 +127,45 @@ public:
 private:
 };
 
-class CitrusJoltJobSystem : public JPH::JobSystemWithBarrier {
+/* jobs run as high priority ctJobSystem jobs, barriers count their unfinished jobs
+ and waiting on them helps out with whatever is queued */
+class CitrusJoltJobSystem : public JPH::JobSystem {
 public:
    CitrusJoltJobSystem() {
-      JobSystemWithBarrier::Init(2048);
-      jobs.Init(2048, 2048);
+      /* the free list is lock free, jobs are recycled without touching a lock */
+      jobs.Init(maxJobs, maxJobs);
+      for (int i = 0; i < maxBarriers; i++) {
+         ctAtomicSet(barriers[i].pending, 0);
+         ctAtomicSet(barriers[i].inUse, 0);
+      }
    }
    virtual int GetMaxConcurrency() const;
    virtual JobHandle CreateJob(const char* name,
                                JPH::ColorArg unused1,
                                const JobFunction& inJobFunction,
                                JPH::uint32 dependencies = 0);
+   virtual Barrier* CreateBarrier();
+   virtual void DestroyBarrier(Barrier* inBarrier);
+   virtual void WaitForJobs(Barrier* inBarrier);
+
+protected:
    virtual void FreeJob(Job* inJob);
    virtual void QueueJob(Job* inJob);
    virtual void QueueJobs(Job** inJobs, unsigned int inNumJobs);
 
 private:
+   class CitrusJoltBarrier : public Barrier {
+   public:
+      virtual void AddJob(const JobHandle& inJob);
+      virtual void AddJobs(const JobHandle* inHandles, JPH::uint inNumHandles);
+      virtual void OnJobFinished(Job* inJob);
+      ctAtomic pending;
+      ctAtomic inUse;
+   };
+   static const JPH::uint maxJobs = 4096;
+   static const int maxBarriers = 8;
+   CitrusJoltBarrier barriers[maxBarriers];
+
    static void ExecuteJob(void* data);
    JPH::FixedSizeFreeList<Job> jobs;
 };
@@ -31,6 +31,26 @@ bool ctResourceBase::isReady() {
    return rstate == CT_RESOURCE_STATE_LOADED || rstate == CT_RESOURCE_STATE_FAILED;
 }
 
+void ctResourceBase::WaitForReady() {
+   if (isReady()) { return; }
+   /* GetOrLoad() creates the task right after the resource becomes visible */
+   ctAsyncTaskHandle task = GetLoadTask();
+   while (!task) {
+      if (isReady()) { return; }
+      ctAtomicSpinPause();
+      task = GetLoadTask();
+   }
+   pCachedServer->Engine->AsyncTasks->Wait(task);
+}
+
+ctResults ctResourceBase::LoadTaskEntry(void* pData) {
+   ctResourceBase* pResource = (ctResourceBase*)pData;
+   const ctResults results = pResource->LoadTask(pResource->pCachedServer->Engine);
+   pResource->SetLoadState(results == CT_SUCCESS ? CT_RESOURCE_STATE_LOADED
+                                                 : CT_RESOURCE_STATE_FAILED);
+   return results;
+}
+
 bool ctResourceBase::isValid() {
    return true;
 }
@@ -43,15 +63,23 @@ void ctResourceBase::Dereference() {
 ctResourceBase* ctResourceServerBase::GetOrLoad(ctGUID guid,
                                                 ctResourcePriority priority) {
    uint64_t key = ctXXHash64(guid.data, sizeof(guid.data));
-   ctSpinLockEnterCriticalScoped(RESOURCE, resourceTableLock);
-   ctResourceBase** ppSearch = resources.FindPtr(key);
-   if (ppSearch) {
-      (*ppSearch)->Reference();
-      return *ppSearch;
+   ctResourceBase* pCreated = NULL;
+   {
+      ctSpinLockEnterCriticalScoped(RESOURCE, resourceTableLock);
+      ctResourceBase** ppSearch = resources.FindPtr(key);
+      if (ppSearch) {
+         (*ppSearch)->Reference();
+         return *ppSearch;
+      }
+      pCreated = NewResource(guid, Engine);
+      resources.Insert(key, pCreated);
+      pCreated->Reference();
    }
-   ctResourceBase* pCreated = NewResource(guid, Engine);
-   resources.Insert(key, pCreated);
-   pCreated->Reference();
+   /* created outside the table spinlock, the task queue takes a mutex
+    resource priorities map straight onto async task priorities */
+   const ctAsyncTaskHandle task = Engine->AsyncTasks->CreateTask(
+     "Resource Load", ctResourceBase::LoadTaskEntry, pCreated, (int32_t)priority);
+   ctAtomicSet(pCreated->loadTask, (int)task);
    return pCreated;
 }
 
@@ -66,14 +94,18 @@ void ctResourceServerBase::DoGarbageCollection() {
       if (state == CT_RESOURCE_STATE_UNLOADED) {
          continue;
       }
-      /* if resource is still loading we cannot cancel it */
-      else if (state == CT_RESOURCE_STATE_LOADING) {
+      /* if resource is still loading (or its task isn't set yet) we cannot cancel it */
+      const ctAsyncTaskHandle loadTask = pResource->GetLoadTask();
+      if (state == CT_RESOURCE_STATE_LOADING || !loadTask ||
+          !Engine->AsyncTasks->isFinished(loadTask)) {
          toGarbageCollectCarryOver.Append(pResource); /* handle later */
          continue;
       }
       /* otherwise we can unload it now */
       pResource->OnRelease(Engine);
       pResource->SetLoadState(CT_RESOURCE_STATE_UNLOADED);
+      Engine->AsyncTasks->ReleaseTask(loadTask);
+      ctAtomicSet(pResource->loadTask, 0);
    }
    /* clear current frames garbage collection and handle remaining next frame */
    toGarbageCollect.Clear();
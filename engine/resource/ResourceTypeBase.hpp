@@ -47,6 +47,7 @@ public:
    inline ctResourceBase(ctResourceServerBase* pServer, ctGUID guid) {
       pCachedServer = pServer;
       dataGUID = guid;
+      ctAtomicSet(loadTask, 0);
       ctAtomicSet(refcount, 0);
       ctAtomicSet(state, CT_RESOURCE_STATE_LOADING);
    }
@@ -72,11 +73,9 @@ public:
    inline ctGUID GetDataGUID() {
       return dataGUID;
    }
-   /* simply just burn cycles while waiting
+   /* blocks on the load task until the loader finished
    avoid doing this as much as possible */
-   inline void WaitForReady() {
-      while (!isReady()) {}
-   }
+   void WaitForReady();
 
 protected:
    friend class ctResourceManager;
@@ -98,7 +97,14 @@ protected:
    }
 
 private:
+   /* runs LoadTask() on the async threads and updates the load state */
+   static ctResults LoadTaskEntry(void* pData);
+   inline ctAsyncTaskHandle GetLoadTask() {
+      return (ctAsyncTaskHandle)ctAtomicGet(loadTask);
+   }
    class ctResourceServerBase* pCachedServer;
+   /* published after the resource is in the table, 0 until then */
+   ctAtomic loadTask;
    ctAtomic refcount;
    ctAtomic state;
    ctGUID dataGUID;
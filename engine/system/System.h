@@ -49,4 +49,33 @@ size_t ctSystemGetDirFileSize(void* handle);
 time_t ctSystemGetDirDate(void* handle);
 
 int ctSystemFileExists(const char* path);
+
+/* Bytes of physical memory currently used by the process */
+size_t ctSystemGetResidentMemory();
+
+/* Address space with no memory behind it until pages of it are committed */
+size_t ctSystemGetPageSize();
+void* ctSystemReserveMemory(size_t size);
+void ctSystemReleaseMemory(void* address, size_t size);
+/* Committed pages read as zero until written */
+int ctSystemCommitMemory(void* address, size_t size);
+int ctSystemDecommitMemory(void* address, size_t size);
+
+/* Read only file for positional reads, safe to read from several threads at once */
+void* ctSystemOpenReadFile(const char* path);
+void ctSystemCloseReadFile(void* handle);
+int64_t ctSystemGetReadFileSize(void* handle);
+/* Returns the bytes read (less than size past the end of the file) or -1 */
+int64_t ctSystemReadFileAt(void* handle, int64_t offset, void* dest, size_t size);
+
+typedef struct ctSystemProcessorInfo {
+   int logicalIndex; /* os processor number */
+   int coreIndex;    /* smt siblings share a core */
+   int cacheIndex;   /* processors sharing a last level cache */
+} ctSystemProcessorInfo;
+
+/* Returns the number of logical processors (can be more than max) or -1 */
+int ctSystemGetProcessorTopology(ctSystemProcessorInfo* pProcessors, int max);
+/* Restricts the calling thread to the given logical processors */
+int ctSystemSetThreadAffinity(const int* pLogicalIndices, int count);
 const char* ctSystemGetGameLayerLibName();
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <winsock.h>
 #pragma comment(lib, "ws2_32.lib")
 #include <Windows.h>
+#include <psapi.h>
 #include <stdio.h>
 
 int ctSystemCreateGUID(void* guidPtr) {
@@ -312,6 +313,181 @@ int ctSystemFileExists(const char* path) {
    return GetFileAttributes(wpath) == INVALID_FILE_ATTRIBUTES ? 0 : 1;
 }
 
+size_t ctSystemGetResidentMemory() {
+   PROCESS_MEMORY_COUNTERS counters;
+   if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return 0;
+   }
+   return counters.WorkingSetSize;
+}
+
+size_t ctSystemGetPageSize() {
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return (size_t)info.dwPageSize;
+}
+
+void* ctSystemReserveMemory(size_t size) {
+   return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+void ctSystemReleaseMemory(void* address, size_t size) {
+   VirtualFree(address, 0, MEM_RELEASE);
+}
+
+int ctSystemCommitMemory(void* address, size_t size) {
+   if (!VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE)) { return -1; }
+   return 0;
+}
+
+int ctSystemDecommitMemory(void* address, size_t size) {
+   if (!VirtualFree(address, size, MEM_DECOMMIT)) { return -1; }
+   return 0;
+}
+
+void* ctSystemOpenReadFile(const char* path) {
+   wchar_t wpath[4096];
+   memset(wpath, 0, 4096 * sizeof(wchar_t));
+   MultiByteToWideChar(CP_UTF8, 0, path, (int)strlen(path), wpath, 4096);
+   /* overlapped so concurrent reads don't serialize on the file pointer */
+   HANDLE file = CreateFile(wpath,
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+                            NULL);
+   if (file == INVALID_HANDLE_VALUE) { return NULL; }
+   return (void*)file;
+}
+
+void ctSystemCloseReadFile(void* handle) {
+   if (!handle) { return; }
+   CloseHandle((HANDLE)handle);
+}
+
+int64_t ctSystemGetReadFileSize(void* handle) {
+   LARGE_INTEGER size;
+   if (!GetFileSizeEx((HANDLE)handle, &size)) { return -1; }
+   return (int64_t)size.QuadPart;
+}
+
+/* one wait event per reading thread, closed when the thread exits */
+struct ctSystemReadEvent {
+   HANDLE event = NULL;
+   ~ctSystemReadEvent() {
+      if (event) { CloseHandle(event); }
+   }
+};
+static thread_local ctSystemReadEvent tReadEvent;
+
+int64_t ctSystemReadFileAt(void* handle, int64_t offset, void* dest, size_t size) {
+   if (!tReadEvent.event) { tReadEvent.event = CreateEvent(NULL, TRUE, FALSE, NULL); }
+   const HANDLE event = tReadEvent.event;
+   if (!event) { return -1; }
+   uint8_t* pDest = (uint8_t*)dest;
+   int64_t total = 0;
+   while (size > 0) {
+      const DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+      OVERLAPPED overlapped = {0};
+      overlapped.Offset = (DWORD)((uint64_t)offset & 0xFFFFFFFF);
+      overlapped.OffsetHigh = (DWORD)((uint64_t)offset >> 32);
+      overlapped.hEvent = event;
+      DWORD read = 0;
+      if (!ReadFile((HANDLE)handle, pDest, chunk, NULL, &overlapped)) {
+         const DWORD error = GetLastError();
+         if (error == ERROR_HANDLE_EOF) { break; }
+         if (error != ERROR_IO_PENDING) { return -1; }
+      }
+      if (!GetOverlappedResult((HANDLE)handle, &overlapped, &read, TRUE)) {
+         if (GetLastError() == ERROR_HANDLE_EOF) { break; }
+         return -1;
+      }
+      if (read == 0) { break; }
+      total += read;
+      offset += read;
+      pDest += read;
+      size -= read;
+   }
+   return total;
+}
+
 const char* ctSystemGetGameLayerLibName() {
    return "game.dll";
 }
+
+int ctSystemGetProcessorTopology(ctSystemProcessorInfo* pProcessors, int max) {
+   DWORD length = 0;
+   GetLogicalProcessorInformationEx(RelationAll, NULL, &length);
+   if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) { return -1; }
+   char* buffer = (char*)malloc(length);
+   if (!buffer) { return -1; }
+   if (!GetLogicalProcessorInformationEx(
+         RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &length)) {
+      free(buffer);
+      return -1;
+   }
+
+   /* cores first, every set bit of their group masks is a logical processor */
+   int count = 0;
+   int coreIndex = 0;
+   BYTE lastCacheLevel = 0;
+   for (DWORD offset = 0; offset < length;) {
+      PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX pInfo =
+        (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer + offset);
+      if (pInfo->Relationship == RelationProcessorCore) {
+         for (WORD g = 0; g < pInfo->Processor.GroupCount; g++) {
+            const GROUP_AFFINITY& group = pInfo->Processor.GroupMask[g];
+            for (int bit = 0; bit < 64; bit++) {
+               if (!(group.Mask & ((KAFFINITY)1 << bit))) { continue; }
+               if (count < max) {
+                  pProcessors[count].logicalIndex = group.Group * 64 + bit;
+                  pProcessors[count].coreIndex = coreIndex;
+                  pProcessors[count].cacheIndex = 0;
+               }
+               count++;
+            }
+         }
+         coreIndex++;
+      } else if (pInfo->Relationship == RelationCache) {
+         if (pInfo->Cache.Level > lastCacheLevel) { lastCacheLevel = pInfo->Cache.Level; }
+      }
+      offset += pInfo->Size;
+   }
+
+   /* then tag processors with the last level cache they sit behind */
+   int cacheIndex = 0;
+   for (DWORD offset = 0; offset < length;) {
+      PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX pInfo =
+        (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer + offset);
+      if (pInfo->Relationship == RelationCache && pInfo->Cache.Level == lastCacheLevel &&
+          (pInfo->Cache.Type == CacheUnified || pInfo->Cache.Type == CacheData)) {
+         const GROUP_AFFINITY& group = pInfo->Cache.GroupMask;
+         for (int i = 0; i < count && i < max; i++) {
+            const int logical = pProcessors[i].logicalIndex;
+            if (logical / 64 != group.Group) { continue; }
+            if (group.Mask & ((KAFFINITY)1 << (logical % 64))) {
+               pProcessors[i].cacheIndex = cacheIndex;
+            }
+         }
+         cacheIndex++;
+      }
+      offset += pInfo->Size;
+   }
+   free(buffer);
+   return count;
+}
+
+int ctSystemSetThreadAffinity(const int* pLogicalIndices, int count) {
+   if (count <= 0) { return -1; }
+   /* a thread can only run within a single processor group */
+   GROUP_AFFINITY affinity;
+   memset(&affinity, 0, sizeof(affinity));
+   affinity.Group = (WORD)(pLogicalIndices[0] / 64);
+   for (int i = 0; i < count; i++) {
+      if (pLogicalIndices[i] / 64 != affinity.Group) { continue; }
+      affinity.Mask |= (KAFFINITY)1 << (pLogicalIndices[i] % 64);
+   }
+   if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL)) { return -1; }
+   return 0;
+}
@@ -0,0 +1,107 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+
+/*
+ * Allocator policies for the containers, they only hand out raw storage and the
+ * container constructs its elements in place.
+ * Policies are held by the container (stateless ones take no space) and are copied
+ * along with it, a policy needs:
+ *    void* Allocate(size_t size, size_t alignment);
+ *    void Free(void* pBlock, size_t size);
+ */
+
+/* Global heap (default) */
+struct ctHeapAllocator {
+   inline void* Allocate(size_t size, size_t alignment) {
+      return alignment <= 16 ? ctMalloc(size) : ctAlignedMalloc(size, alignment);
+   }
+   inline void Free(void* pBlock, size_t size) {
+      ctAlignedFree(pBlock);
+   }
+};
+
+/* Global heap charged to a fixed tag, small blocks come from the tag's own slabs
+ so long lived containers stay packed together away from the churn of other tags */
+template<ctMemoryTag Tag>
+struct ctTaggedAllocator {
+   inline void* Allocate(size_t size, size_t alignment) {
+      ctMemoryTagScoped(Tag);
+      return ctHeapAllocator().Allocate(size, alignment);
+   }
+   inline void Free(void* pBlock, size_t size) {
+      ctAlignedFree(pBlock);
+   }
+};
+
+class ctFrameArena;
+CT_API ctFrameArena* ctGetFrameArena();
+CT_API void* ctFrameArenaAlloc(ctFrameArena* pArena, size_t size, size_t alignment);
+
+/* Frame arena, storage is dropped with the arena at the end of the frame
+ Without an arena the calling thread's arena is used. */
+struct ctFrameArenaAllocator {
+   inline ctFrameArenaAllocator(ctFrameArena* pArena = NULL) {
+      this->pArena = pArena;
+   }
+   inline void* Allocate(size_t size, size_t alignment) {
+      return ctFrameArenaAlloc(pArena ? pArena : ctGetFrameArena(), size, alignment);
+   }
+   inline void Free(void* pBlock, size_t size) {
+      /* the arena takes the memory back on reset */
+   }
+   ctFrameArena* pArena;
+};
+
+/* std::move without the standard library, for moving elements between storage */
+template<class T>
+struct ctRemoveReference {
+   typedef T Type;
+};
+template<class T>
+struct ctRemoveReference<T&> {
+   typedef T Type;
+};
+template<class T>
+struct ctRemoveReference<T&&> {
+   typedef T Type;
+};
+
+template<class T>
+inline typename ctRemoveReference<T>::Type&& ctMove(T&& value) {
+   return static_cast<typename ctRemoveReference<T>::Type&&>(value);
+}
+
+template<class T>
+inline T&& ctForward(typename ctRemoveReference<T>::Type& value) {
+   return static_cast<T&&>(value);
+}
+
+/* Types that can be moved to new storage with memcpy, leaving nothing to destroy
+ Anything trivially copyable is, types that only own pointers to heap storage (no
+ pointers back into themselves) can opt in with CT_TRIVIALLY_RELOCATABLE. */
+template<class T>
+struct ctIsTriviallyRelocatable {
+   static const bool value = __is_trivially_copyable(T);
+};
+#define CT_TRIVIALLY_RELOCATABLE(_TYPE)                                                  \
+   template<>                                                                            \
+   struct ctIsTriviallyRelocatable<_TYPE> {                                              \
+      static const bool value = true;                                                    \
+   }
@@ -26,6 +26,8 @@
 #define ZoneScoped
 #define TracyAlloc(A, B)
 #define TracyFree(A)
+#define TracyAllocN(A, B, C)
+#define TracyFreeN(A, B)
 #define TracyMessage(A, B)
 #define TracyMessageC(A, B, C)
 #define FrameMark
@@ -160,6 +162,7 @@ enum ctResults {
 
 #define ctErrorCheck(_msg) (_msg != CT_SUCCESS)
 
+/* Cache line aligned, smaller allocations come from pools and are 16 byte aligned */
 CT_API void* ctMalloc(size_t size);
 CT_API void* ctRealloc(void* old, size_t size);
 CT_API void ctFree(void* block);
@@ -180,15 +183,70 @@ ctGroupAlloc(size_t count, struct ctGroupAllocDesc* groups, size_t* pSizeOut);
 
 CT_API size_t ctGetAliveAllocations();
 
+/* Address space reserved up front with pages committed on demand (see ctVirtualArray)
+ Sizes and addresses are multiples of ctVirtualPageSize(), new pages read as zero */
+CT_API size_t ctVirtualPageSize();
+CT_API void* ctVirtualReserve(size_t size);
+CT_API void ctVirtualRelease(void* address, size_t size);
+CT_API enum ctResults ctVirtualCommit(void* address, size_t size);
+CT_API enum ctResults ctVirtualDecommit(void* address, size_t size);
+
+/* Allocations are charged to the tag on top of the calling thread's tag stack */
+enum ctMemoryTag {
+   CT_MEMORY_TAG_GENERAL,
+   CT_MEMORY_TAG_CORE,
+   CT_MEMORY_TAG_RESOURCE,
+   CT_MEMORY_TAG_RENDERER,
+   CT_MEMORY_TAG_PHYSICS,
+   CT_MEMORY_TAG_ANIMATION,
+   CT_MEMORY_TAG_SCENE,
+   CT_MEMORY_TAG_UI,
+   CT_MEMORY_TAG_INTERACT,
+   CT_MEMORY_TAG_AUDITION,
+   CT_MEMORY_TAG_GAME,
+   CT_MEMORY_TAG_COUNT
+};
+
+/* Pooled blocks count their size class, other threads report in batches so the
+ numbers (especially the high water mark) are approximate while they run */
+struct ctMemoryTagStats {
+   int64_t bytes;
+   int64_t count;
+   int64_t highWater;
+};
+
+CT_API void ctMemoryTagPush(enum ctMemoryTag tag);
+CT_API void ctMemoryTagPop();
+CT_API enum ctMemoryTag ctMemoryTagGetCurrent();
+CT_API const char* ctMemoryTagGetName(enum ctMemoryTag tag);
+CT_API struct ctMemoryTagStats ctMemoryTagGetStats(enum ctMemoryTag tag);
+/* Restarts the high water marks from the current usage */
+CT_API void ctMemoryTagResetHighWater();
+
 #ifdef __cplusplus
 }
 #endif
 
+#ifdef __cplusplus
+/* Charges every allocation in the scope to the tag */
+class ctMemoryTagScope {
+public:
+   inline ctMemoryTagScope(ctMemoryTag tag) {
+      ctMemoryTagPush(tag);
+   }
+   inline ~ctMemoryTagScope() {
+      ctMemoryTagPop();
+   }
+};
+#define ctMemoryTagScoped(_TAG) ctMemoryTagScope _ctMemoryTagScope(_TAG)
+#endif
+
 /*Include common cpp files*/
 #ifdef __cplusplus
 #include "SharedLogging.h"
 #include "DynamicArray.hpp"
 #include "GUID.hpp"
+#include "Sync.hpp"
 #include "HandleManager.hpp"
 #include "StaticArray.hpp"
 #include "Reflect.hpp"
@@ -198,7 +256,6 @@ CT_API size_t ctGetAliveAllocations();
 #include "Hash.hpp"
 #include "String.hpp"
 #include "HashTable.hpp"
-#include "Sync.hpp"
 #include "JSON.hpp"
 #include "Time.hpp"
 #include "File.hpp"
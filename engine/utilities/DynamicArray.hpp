@@ -17,14 +17,24 @@
 #pragma once
 
 #include "Common.h"
-
-template<class T>
-class ctDynamicArray {
+#include "Allocator.hpp"
+#include <new>
+
+/* Storage comes from the Allocator policy (see Allocator.hpp)
+ Only the first Count() elements are constructed, the rest of the capacity is raw.
+ Growth moves the elements over, with a memcpy for trivially relocatable types. */
+template<class T, class Allocator = ctHeapAllocator>
+class ctDynamicArray : private Allocator {
 public:
    /* Constructors */
    ctDynamicArray();
-   ctDynamicArray(ctDynamicArray<T>& arr);
-   ctDynamicArray(const ctDynamicArray<T>& arr);
+   /* ex: ctDynamicArray<T, ctFrameArenaAllocator> scratch(pArena) */
+   explicit ctDynamicArray(const Allocator& allocator);
+   ctDynamicArray(ctDynamicArray<T, Allocator>& arr);
+   ctDynamicArray(const ctDynamicArray<T, Allocator>& arr);
+   /* Copies into this array's own storage */
+   template<class OtherAllocator>
+   ctDynamicArray(const ctDynamicArray<T, OtherAllocator>& arr);
    /* Destructor */
    ~ctDynamicArray();
    /* Array Access */
@@ -42,19 +52,25 @@ public:
    /* Reserve */
    ctResults Resize(const size_t amount);
    ctResults Reserve(const size_t amount);
+   /* Capacity of the first growth and added on every growth after (default 32) */
+   void SetGrowthStep(const size_t amount);
    /* Data */
    T* Data() const;
    /* Count */
    size_t Count() const;
    size_t Capacity() const;
    /* Assignment */
-   ctDynamicArray<T>& operator=(const ctDynamicArray<T>& arr);
+   ctDynamicArray<T, Allocator>& operator=(const ctDynamicArray<T, Allocator>& arr);
    /* Append */
    ctResults Append(T&& val);
    ctResults Append(const T& val);
-   ctResults Append(const ctDynamicArray<T>& arr);
+   template<class OtherAllocator>
+   ctResults Append(const ctDynamicArray<T, OtherAllocator>& arr);
    ctResults Append(const T* pArray, const size_t length);
    ctResults Append(const T& val, const size_t amount);
+   /* Constructs the new last element from args, NULL if it can't grow */
+   template<class... Args>
+   T* EmplaceBack(Args&&... args);
    /* Insert */
    ctResults Insert(const T& val, const int64_t position);
    ctResults InsertUnique(const T& val);
@@ -91,266 +107,387 @@ public:
    uint64_t xxHash64(const int seed) const;
    uint64_t xxHash64() const;
 
+   Allocator& GetAllocator();
+
 private:
    ctResults _expand_size(size_t amount);
+   T* _allocate(const size_t amount);
+   void _release(T* pData, const size_t capacity);
+   void _destroy(const size_t begin, const size_t end);
+   void _relocate(T* pDest, T* pSource, const size_t amount);
+   bool _isInside(const T* pVal) const;
    T* _pData;
    size_t _capacity;
    size_t _count;
+   size_t _growthStep;
+};
+
+template<class T, class Allocator>
+struct ctIsTriviallyRelocatable<ctDynamicArray<T, Allocator>> {
+   static const bool value = true;
 };
 
-template<class T>
-inline ctResults ctDynamicArray<T>::_expand_size(size_t amount) {
+template<class T, class Allocator>
+inline T* ctDynamicArray<T, Allocator>::_allocate(const size_t amount) {
+   return (T*)Allocator::Allocate(sizeof(T) * amount, alignof(T));
+}
+
+/* Storage only, elements must already be destroyed or relocated */
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::_release(T* pData, const size_t capacity) {
+   if (!pData) { return; }
+   Allocator::Free(pData, sizeof(T) * capacity);
+}
+
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::_destroy(const size_t begin, const size_t end) {
+   for (size_t i = begin; i < end; i++) {
+      _pData[i].~T();
+   }
+}
+
+/* pSource is left as raw storage */
+template<class T, class Allocator>
+inline void
+ctDynamicArray<T, Allocator>::_relocate(T* pDest, T* pSource, const size_t amount) {
+   if (ctIsTriviallyRelocatable<T>::value) {
+      memcpy((void*)pDest, (const void*)pSource, sizeof(T) * amount);
+      return;
+   }
+   for (size_t i = 0; i < amount; i++) {
+      new (&pDest[i]) T(ctMove(pSource[i]));
+      pSource[i].~T();
+   }
+}
+
+/* Values from inside the array have to be copied before it grows or shifts */
+template<class T, class Allocator>
+inline bool ctDynamicArray<T, Allocator>::_isInside(const T* pVal) const {
+   return _pData && pVal >= _pData && pVal < _pData + _count;
+}
+
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::_expand_size(size_t amount) {
    const size_t neededamount = Count() + amount;
    const size_t originalcapacity = Capacity();
    if (neededamount > originalcapacity) {
       size_t targetamount = Capacity();
-      if (targetamount <= 0) { targetamount = 32; }
+      if (targetamount <= 0) { targetamount = _growthStep; }
       while (targetamount < neededamount) {
-         targetamount += 32;
+         targetamount += _growthStep;
       }
       return Reserve(targetamount);
    }
    return CT_SUCCESS;
 }
 
-template<class T>
-inline ctDynamicArray<T>::ctDynamicArray() {
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>::ctDynamicArray() {
+   _pData = NULL;
+   _capacity = 0;
+   _count = 0;
+   _growthStep = 32;
+}
+
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>::ctDynamicArray(const Allocator& allocator) :
+    Allocator(allocator) {
    _pData = NULL;
    _capacity = 0;
    _count = 0;
+   _growthStep = 32;
 }
 
-template<class T>
-inline ctDynamicArray<T>::ctDynamicArray(const ctDynamicArray<T>& arr) :
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>::ctDynamicArray(
+  const ctDynamicArray<T, Allocator>& arr) :
+    ctDynamicArray((const Allocator&)arr) {
+   _growthStep = arr._growthStep;
+   Append(arr.Data(), arr.Count());
+}
+
+template<class T, class Allocator>
+template<class OtherAllocator>
+inline ctDynamicArray<T, Allocator>::ctDynamicArray(
+  const ctDynamicArray<T, OtherAllocator>& arr) :
     ctDynamicArray() {
-   const size_t inputcount = arr.Count();
-   Resize(inputcount);
-   for (size_t i = 0; i < inputcount; i++) {
-      _pData[i] = arr[i];
-   }
+   Append(arr.Data(), arr.Count());
 }
 
-template<class T>
-inline ctDynamicArray<T>::ctDynamicArray(ctDynamicArray<T>& arr) :
-    ctDynamicArray((const ctDynamicArray<T>&)arr) {
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>::ctDynamicArray(ctDynamicArray<T, Allocator>& arr) :
+    ctDynamicArray((const ctDynamicArray<T, Allocator>&)arr) {
 }
 
-template<class T>
-inline ctDynamicArray<T>::~ctDynamicArray() {
-   if (_pData) { delete[] _pData; }
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>::~ctDynamicArray() {
+   _destroy(0, _count);
+   _release(_pData, _capacity);
    _pData = NULL;
    _capacity = 0;
    _count = 0;
 }
 
-template<class T>
-inline T& ctDynamicArray<T>::operator[](const size_t index) {
+template<class T, class Allocator>
+inline T& ctDynamicArray<T, Allocator>::operator[](const size_t index) {
    ctAssert(index < Count());
    ctAssert(_pData);
    return _pData[index];
 }
 
-template<class T>
-inline T ctDynamicArray<T>::operator[](const size_t index) const {
+template<class T, class Allocator>
+inline T ctDynamicArray<T, Allocator>::operator[](const size_t index) const {
    ctAssert(index < Count());
    ctAssert(_pData);
    return _pData[index];
 }
 
-template<class T>
-inline T& ctDynamicArray<T>::First() {
+template<class T, class Allocator>
+inline T& ctDynamicArray<T, Allocator>::First() {
    ctAssert(Count() > 0);
    ctAssert(_pData);
    return _pData[0];
 }
 
-template<class T>
-inline T ctDynamicArray<T>::First() const {
+template<class T, class Allocator>
+inline T ctDynamicArray<T, Allocator>::First() const {
    ctAssert(Count() > 0);
    ctAssert(_pData);
    return _pData[0];
 }
 
-template<class T>
-inline T& ctDynamicArray<T>::Last() {
+template<class T, class Allocator>
+inline T& ctDynamicArray<T, Allocator>::Last() {
    size_t idx = Count() - 1 > 0 ? Count() - 1 : 0;
    ctAssert(Count() > 0);
    ctAssert(_pData);
    return _pData[idx];
 }
 
-template<class T>
-inline T ctDynamicArray<T>::Last() const {
+template<class T, class Allocator>
+inline T ctDynamicArray<T, Allocator>::Last() const {
    size_t idx = Count() - 1 > 0 ? Count() - 1 : 0;
    ctAssert(Count() > 0);
    ctAssert(_pData);
    return _pData[idx];
 }
 
-template<class T>
-inline T* ctDynamicArray<T>::Begin() {
+template<class T, class Allocator>
+inline T* ctDynamicArray<T, Allocator>::Begin() {
    ctAssert(_pData);
    return pData;
 }
 
-template<class T>
-inline const T* ctDynamicArray<T>::Begin() const {
+template<class T, class Allocator>
+inline const T* ctDynamicArray<T, Allocator>::Begin() const {
    ctAssert(_pData);
    return pData;
 }
 
-template<class T>
-inline T* ctDynamicArray<T>::End() {
+template<class T, class Allocator>
+inline T* ctDynamicArray<T, Allocator>::End() {
    ctAssert(_pData);
    return pData + Count();
 }
 
-template<class T>
-inline const T* ctDynamicArray<T>::End() const {
+template<class T, class Allocator>
+inline const T* ctDynamicArray<T, Allocator>::End() const {
    ctAssert(_pData);
    return pData + Count();
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Resize(const size_t amount) {
-   if (amount == Count()) {
-      return CT_SUCCESS;
-   } else if (amount <= 0) {
-      _pData = NULL;
-      Clear();
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Resize(const size_t amount) {
+   if (amount <= Count()) {
+      _destroy(amount, _count);
+      _count = amount;
       return CT_SUCCESS;
    }
-   T* pOldData = _pData;
-   _pData = new T[amount];
-   ctAssert(_pData);
-   const size_t copyBound = amount > _count ? _count : amount;
-   if (pOldData) {
-      for (size_t i = 0; i < copyBound; i++) {
-         _pData[i] = pOldData[i];
-      }
-      delete[] pOldData;
+   const ctResults result = Reserve(amount);
+   if (result != CT_SUCCESS) { return result; }
+   /* same as new T[], plain data is left uninitialized */
+   for (size_t i = _count; i < amount; i++) {
+      new (&_pData[i]) T;
    }
    _count = amount;
-   _capacity = amount;
    return CT_SUCCESS;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Reserve(const size_t amount) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Reserve(const size_t amount) {
    if (amount > Capacity()) {
-      T* pOldData = _pData;
-      _pData = new T[amount];
-      ctAssert(_pData);
-      if (pOldData) {
-         for (size_t i = 0; i < Count(); i++) {
-            _pData[i] = pOldData[i];
-         }
-         delete[] pOldData;
+      T* pNewData = _allocate(amount);
+      ctAssert(pNewData);
+      if (!pNewData) { return CT_FAILURE_OUT_OF_MEMORY; }
+      if (_pData) {
+         _relocate(pNewData, _pData, _count);
+         _release(_pData, _capacity);
       }
+      _pData = pNewData;
       _capacity = amount;
    }
    return CT_SUCCESS;
 }
 
-template<class T>
-inline T* ctDynamicArray<T>::Data() const {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::SetGrowthStep(const size_t amount) {
+   _growthStep = amount > 0 ? amount : 1;
+}
+
+template<class T, class Allocator>
+inline T* ctDynamicArray<T, Allocator>::Data() const {
    return _pData;
 }
 
-template<class T>
-inline size_t ctDynamicArray<T>::Count() const {
+template<class T, class Allocator>
+inline size_t ctDynamicArray<T, Allocator>::Count() const {
    return _count;
 }
 
-template<class T>
-inline size_t ctDynamicArray<T>::Capacity() const {
+template<class T, class Allocator>
+inline size_t ctDynamicArray<T, Allocator>::Capacity() const {
    return _capacity;
 }
 
-template<class T>
-inline ctDynamicArray<T>& ctDynamicArray<T>::operator=(const ctDynamicArray<T>& arr) {
-   if (arr.isEmpty()) { return *this; }
-   const size_t inputcount = arr.Count();
-   Resize(inputcount);
-   for (size_t i = 0; i < inputcount; i++) {
-      _pData[i] = arr[i];
-   }
+template<class T, class Allocator>
+inline ctDynamicArray<T, Allocator>&
+ctDynamicArray<T, Allocator>::operator=(const ctDynamicArray<T, Allocator>& arr) {
+   if (arr.isEmpty() || &arr == this) { return *this; }
+   Clear();
+   Append(arr.Data(), arr.Count());
    return *this;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Append(const T& val) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Append(const T& val) {
+   if (_count == _capacity && _isInside(&val)) {
+      T copy(val);
+      return Append(ctMove(copy));
+   }
    const ctResults result = _expand_size(1);
    if (result != CT_SUCCESS) { return result; }
-   if (_pData) { _pData[Count()] = val; }
+   new (&_pData[_count]) T(val);
    _count++;
    return result;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Append(T&& val) {
-   return Append((const T&)val);
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Append(T&& val) {
+   if (_count == _capacity && _isInside(&val)) {
+      T moved(ctMove(val));
+      return Append(ctMove(moved));
+   }
+   const ctResults result = _expand_size(1);
+   if (result != CT_SUCCESS) { return result; }
+   new (&_pData[_count]) T(ctMove(val));
+   _count++;
+   return result;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Append(const ctDynamicArray<T>& arr) {
+template<class T, class Allocator>
+template<class... Args>
+inline T* ctDynamicArray<T, Allocator>::EmplaceBack(Args&&... args) {
+   if (_expand_size(1) != CT_SUCCESS) { return NULL; }
+   T* pResult = new (&_pData[_count]) T(ctForward<Args>(args)...);
+   _count++;
+   return pResult;
+}
+
+template<class T, class Allocator>
+template<class OtherAllocator>
+inline ctResults
+ctDynamicArray<T, Allocator>::Append(const ctDynamicArray<T, OtherAllocator>& arr) {
    return Append(arr.Data(), arr.Count());
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Append(const T* pArray, const size_t length) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Append(const T* pArray,
+                                                      const size_t length) {
+   if (_isInside(pArray) && Count() + length > Capacity()) {
+      ctDynamicArray<T, Allocator> copy((const Allocator&)*this);
+      copy.Append(pArray, length);
+      return Append(copy.Data(), length);
+   }
    const ctResults result = Reserve(Count() + length);
    if (result != CT_SUCCESS) { return result; }
-   for (int i = 0; i < length; i++) {
-      Append(pArray[i]);
+   for (size_t i = 0; i < length; i++) {
+      new (&_pData[_count + i]) T(pArray[i]);
    }
+   _count += length;
    return result;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Append(const T& val, const size_t amount) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Append(const T& val, const size_t amount) {
+   if (_isInside(&val) && Count() + amount > Capacity()) {
+      T copy(val);
+      return Append(copy, amount);
+   }
    const ctResults result = Reserve(Count() + amount);
    if (result != CT_SUCCESS) { return result; }
-   for (int i = 0; i < amount; i++) {
-      Append(val);
+   for (size_t i = 0; i < amount; i++) {
+      new (&_pData[_count + i]) T(val);
    }
+   _count += amount;
    return result;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Insert(const T& val, const int64_t position) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Insert(const T& val,
+                                                      const int64_t position) {
+   if (_isInside(&val)) {
+      T copy(val);
+      return Insert(copy, position);
+   }
    int64_t finalposition = position < 0 ? Count() + 1 + position : position;
    const ctResults result = _expand_size(1);
    if (result != CT_SUCCESS) { return result; }
    if (finalposition < 0) { finalposition = 0; }
    if (finalposition > (int64_t)Count()) { finalposition = Count(); }
-   for (int64_t i = Count(); i > finalposition; i--) {
-      _pData[i] = _pData[i - 1];
+   if (ctIsTriviallyRelocatable<T>::value) {
+      memmove((void*)&_pData[finalposition + 1],
+              (const void*)&_pData[finalposition],
+              sizeof(T) * (Count() - finalposition));
+   } else if (finalposition < (int64_t)Count()) {
+      new (&_pData[Count()]) T(ctMove(_pData[Count() - 1]));
+      for (int64_t i = Count() - 1; i > finalposition; i--) {
+         _pData[i] = ctMove(_pData[i - 1]);
+      }
+      _pData[finalposition].~T();
    }
+   new (&_pData[finalposition]) T(val);
    _count++;
-   _pData[finalposition] = val;
    return result;
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::InsertUnique(const T& val) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::InsertUnique(const T& val) {
    if (Exists(val)) { return CT_FAILURE_DUPLICATE_ENTRY; }
    return Append(val);
 }
 
-template<class T>
-inline void ctDynamicArray<T>::RemoveAt(const int64_t position) {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::RemoveAt(const int64_t position) {
    if (isEmpty()) { return; }
    const int64_t finalposition = position < 0 ? Count() + position : position;
    if (finalposition < 0 || finalposition >= (int64_t)Count()) { return; }
    _count--;
+   if (ctIsTriviallyRelocatable<T>::value) {
+      _pData[finalposition].~T();
+      memmove((void*)&_pData[finalposition],
+              (const void*)&_pData[finalposition + 1],
+              sizeof(T) * (Count() - finalposition));
+      return;
+   }
    for (int64_t i = finalposition; i < (int64_t)Count(); i++) {
-      _pData[i] = _pData[i + 1];
+      _pData[i] = ctMove(_pData[i + 1]);
    }
+   _pData[Count()].~T();
 }
 
-template<class T>
-inline ctResults ctDynamicArray<T>::Remove(const T& val, const int64_t position) {
+template<class T, class Allocator>
+inline ctResults ctDynamicArray<T, Allocator>::Remove(const T& val,
+                                                      const int64_t position) {
    int64_t idx = FindIndex(val, position, 1);
    if (idx >= 0 && idx < (int64_t)Count()) {
       RemoveAt(idx);
@@ -360,42 +497,43 @@ inline ctResults ctDynamicArray<T>::Remove(const T& val, const int64_t position)
    }
 }
 
-template<class T>
-inline void ctDynamicArray<T>::RemoveFirst() {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::RemoveFirst() {
    RemoveAt(0);
 }
 
-template<class T>
-inline void ctDynamicArray<T>::RemoveLast() {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::RemoveLast() {
    RemoveAt(-1);
 }
 
-template<class T>
-inline void ctDynamicArray<T>::RemoveAllOf(const T& val) {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::RemoveAllOf(const T& val) {
    while (Remove(val) == CT_SUCCESS)
       ;
 }
 
-template<class T>
-inline void ctDynamicArray<T>::Clear() {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::Clear() {
+   _destroy(0, _count);
    _count = 0;
 }
 
-template<class T>
-inline void ctDynamicArray<T>::Memset(int val) {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::Memset(int val) {
    if (isEmpty()) { return; }
    memset(Data(), val, Capacity() * sizeof(T));
 }
 
-template<class T>
-inline bool ctDynamicArray<T>::isEmpty() const {
+template<class T, class Allocator>
+inline bool ctDynamicArray<T, Allocator>::isEmpty() const {
    return _count == 0 || !_pData;
 }
 
-template<class T>
-inline int64_t ctDynamicArray<T>::FindIndex(const T& val,
-                                            const int64_t position,
-                                            const int direction) const {
+template<class T, class Allocator>
+inline int64_t ctDynamicArray<T, Allocator>::FindIndex(const T& val,
+                                                       const int64_t position,
+                                                       const int direction) const {
    if (isEmpty()) { return -1; }
    const int64_t amount = (int64_t)Count();
    const int64_t finalposition = position < 0 ? Count() + position : position;
@@ -407,26 +545,26 @@ inline int64_t ctDynamicArray<T>::FindIndex(const T& val,
    return -1;
 }
 
-template<class T>
-inline T* ctDynamicArray<T>::FindPtr(const T& val,
-                                     const int64_t position,
-                                     const int direction) const {
+template<class T, class Allocator>
+inline T* ctDynamicArray<T, Allocator>::FindPtr(const T& val,
+                                                const int64_t position,
+                                                const int direction) const {
    if (isEmpty()) { return NULL; }
    const int64_t idx = FindIndex(val, position, direction);
    return idx >= 0 ? &(Data()[idx]) : NULL;
 }
 
-template<class T>
-inline T& ctDynamicArray<T>::Fetch(const T& val) const {
+template<class T, class Allocator>
+inline T& ctDynamicArray<T, Allocator>::Fetch(const T& val) const {
    int64_t idx = FindIndex(val);
    ctAssert(idx >= 0);
    return Data()[idx];
 }
 
-template<class T>
-inline void ctDynamicArray<T>::QSort(int (*compare)(const T*, const T*),
-                                     const size_t position,
-                                     const size_t amount) {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::QSort(int (*compare)(const T*, const T*),
+                                                const size_t position,
+                                                const size_t amount) {
    if (isEmpty()) { return; }
    size_t adjustedAmount = amount == 0 ? Count() : amount;
    const size_t remainingCount = Count() - position;
@@ -435,57 +573,62 @@ inline void ctDynamicArray<T>::QSort(int (*compare)(const T*, const T*),
    qsort(Data(), finalAmount, sizeof(T), (int (*)(void const*, void const*))compare);
 }
 
-template<class T>
-inline void ctDynamicArray<T>::Reverse() {
+template<class T, class Allocator>
+inline void ctDynamicArray<T, Allocator>::Reverse() {
    if (isEmpty()) { return; }
    size_t left = 0;
    size_t right = Count() - 1;
    while (left < right) {
-      T tmp = _pData[left];
-      _pData[left] = _pData[right];
-      _pData[right] = tmp;
+      T tmp = ctMove(_pData[left]);
+      _pData[left] = ctMove(_pData[right]);
+      _pData[right] = ctMove(tmp);
       left++;
       right--;
    }
 }
 
-template<class T>
-inline uint32_t ctDynamicArray<T>::xxHash32(const size_t position,
-                                            const size_t amount,
-                                            const int seed) const {
+template<class T, class Allocator>
+inline uint32_t ctDynamicArray<T, Allocator>::xxHash32(const size_t position,
+                                                       const size_t amount,
+                                                       const int seed) const {
    if (isEmpty()) { return 0; }
    return XXH32((const void*)(Data() + position), amount, seed);
 }
 
-template<class T>
-inline uint32_t ctDynamicArray<T>::xxHash32(const int seed) const {
+template<class T, class Allocator>
+inline uint32_t ctDynamicArray<T, Allocator>::xxHash32(const int seed) const {
    return xxHash32(0, Count(), seed);
 }
 
-template<class T>
-inline uint32_t ctDynamicArray<T>::xxHash32() const {
+template<class T, class Allocator>
+inline uint32_t ctDynamicArray<T, Allocator>::xxHash32() const {
    return xxHash32(0);
 }
 
-template<class T>
-inline uint64_t ctDynamicArray<T>::xxHash64(const size_t position,
-                                            const size_t amount,
-                                            const int seed) const {
+template<class T, class Allocator>
+inline uint64_t ctDynamicArray<T, Allocator>::xxHash64(const size_t position,
+                                                       const size_t amount,
+                                                       const int seed) const {
    if (isEmpty()) { return 0; }
    return XXH64((const void*)(Data() + position), amount, seed);
 }
 
-template<class T>
-inline uint64_t ctDynamicArray<T>::xxHash64(const int seed) const {
+template<class T, class Allocator>
+inline uint64_t ctDynamicArray<T, Allocator>::xxHash64(const int seed) const {
    return xxHash64(0, Count(), seed);
 }
 
-template<class T>
-inline uint64_t ctDynamicArray<T>::xxHash64() const {
+template<class T, class Allocator>
+inline uint64_t ctDynamicArray<T, Allocator>::xxHash64() const {
    return xxHash64(0);
 }
 
-template<class T>
-inline bool ctDynamicArray<T>::Exists(const T& val) const {
+template<class T, class Allocator>
+inline bool ctDynamicArray<T, Allocator>::Exists(const T& val) const {
    return FindIndex(val, 0, 1) != -1 ? true : false;
-}
\ No newline at end of file
+}
+
+template<class T, class Allocator>
+inline Allocator& ctDynamicArray<T, Allocator>::GetAllocator() {
+   return *this;
+}
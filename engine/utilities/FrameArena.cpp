@@ -0,0 +1,177 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FrameArena.hpp"
+
+/* bumped by ctFrameArenaResetAll(), ctFrameArenaResetThread() resets when behind */
+static ctAtomic64 gFrameArenaEpoch;
+
+ctFrameArena::ctFrameArena(size_t blockSize) {
+   this->blockSize = blockSize;
+   used = 0;
+   highWater = 0;
+   capacity = 0;
+   overflows = 0;
+   pFirst = NewBlock(blockSize);
+   pCurrent = pFirst;
+}
+
+ctFrameArena::~ctFrameArena() {
+   Block* pBlock = pFirst;
+   while (pBlock) {
+      Block* pNext = pBlock->pNext;
+      ctAlignedFree(pBlock);
+      pBlock = pNext;
+   }
+}
+
+ctFrameArena::Block* ctFrameArena::NewBlock(size_t blockCapacity) {
+   Block* pBlock =
+     (Block*)ctAlignedMalloc(sizeof(Block) + blockCapacity, CT_ALIGNMENT_CACHE);
+   ctAssert(pBlock);
+   pBlock->pNext = NULL;
+   pBlock->capacity = blockCapacity;
+   pBlock->used = 0;
+   capacity += blockCapacity;
+   return pBlock;
+}
+
+void* ctFrameArena::Alloc(size_t size, size_t alignment) {
+   ctAssert(alignment && (alignment & (alignment - 1)) == 0);
+   uint8_t* pBase = (uint8_t*)(pCurrent + 1);
+   size_t offset = ctAlign(pCurrent->used + (size_t)pBase, alignment) - (size_t)pBase;
+   if (offset + size > pCurrent->capacity) {
+      /* chain on a block big enough to take it */
+      size_t nextCapacity = blockSize > size + alignment ? blockSize : size + alignment;
+      Block* pBlock = NewBlock(nextCapacity);
+      pCurrent->pNext = pBlock;
+      pCurrent = pBlock;
+      overflows++;
+      pBase = (uint8_t*)(pCurrent + 1);
+      offset = ctAlign((size_t)pBase, alignment) - (size_t)pBase;
+   }
+   used += offset - pCurrent->used + size;
+   pCurrent->used = offset + size;
+   if (used > highWater) { highWater = used; }
+   return pBase + offset;
+}
+
+void ctFrameArena::Reset() {
+   if (pFirst->pNext) {
+      /* the frame didn't fit, replace the chain with one block that would have */
+      Block* pBlock = pFirst;
+      while (pBlock) {
+         Block* pNext = pBlock->pNext;
+         ctAlignedFree(pBlock);
+         pBlock = pNext;
+      }
+      capacity = 0;
+      while (blockSize < highWater) {
+         blockSize *= 2;
+      }
+      pFirst = NewBlock(blockSize);
+   }
+   pFirst->used = 0;
+   pCurrent = pFirst;
+   used = 0;
+}
+
+ctFrameArenaStats ctFrameArena::GetStats() const {
+   ctFrameArenaStats stats = ctFrameArenaStats();
+   stats.used = used;
+   stats.highWater = highWater;
+   stats.capacity = capacity;
+   stats.overflows = overflows;
+   return stats;
+}
+
+/* ------------- Thread Arenas ------------- */
+
+struct ctFrameArenaRegistry {
+   ctFrameArenaRegistry() {
+      ctSpinLockInit(lock);
+   }
+   ctSpinLock lock;
+   ctDynamicArray<ctFrameArena*> arenas;
+};
+
+static ctFrameArenaRegistry& ctGetFrameArenaRegistry() {
+   static ctFrameArenaRegistry registry;
+   return registry;
+}
+
+/* unregisters the arena when its thread exits */
+struct ctFrameArenaThreadSlot {
+   ctFrameArena* pArena = NULL;
+   int64_t epoch = 0;
+   void Create() {
+      pArena = new ctFrameArena();
+      epoch = ctAtomic64GetAcquire(gFrameArenaEpoch);
+   }
+   ~ctFrameArenaThreadSlot() {
+      if (!pArena) { return; }
+      ctFrameArenaRegistry& registry = ctGetFrameArenaRegistry();
+      ctSpinLockEnterCritical(registry.lock);
+      registry.arenas.Remove(pArena);
+      ctSpinLockExitCritical(registry.lock);
+      delete pArena;
+   }
+};
+static thread_local ctFrameArenaThreadSlot tFrameArenaSlot;
+
+CT_API ctFrameArena* ctGetFrameArena() {
+   if (!tFrameArenaSlot.pArena) {
+      tFrameArenaSlot.Create();
+      ctFrameArenaRegistry& registry = ctGetFrameArenaRegistry();
+      ctSpinLockEnterCritical(registry.lock);
+      registry.arenas.Append(tFrameArenaSlot.pArena);
+      ctSpinLockExitCritical(registry.lock);
+   }
+   return tFrameArenaSlot.pArena;
+}
+
+CT_API void ctFrameArenaResetAll() {
+   ZoneScoped;
+   /* other threads may still be using frame memory, they reset themselves later */
+   ctAtomic64Add(gFrameArenaEpoch, 1);
+}
+
+CT_API void ctFrameArenaResetThread() {
+   if (!tFrameArenaSlot.pArena) { return; }
+   const int64_t current = ctAtomic64GetAcquire(gFrameArenaEpoch);
+   if (tFrameArenaSlot.epoch == current) { return; }
+   tFrameArenaSlot.pArena->Reset();
+   tFrameArenaSlot.epoch = current;
+}
+
+CT_API ctFrameArenaStats ctFrameArenaGetTotalStats() {
+   ctFrameArenaStats total = ctFrameArenaStats();
+   ctFrameArenaRegistry& registry = ctGetFrameArenaRegistry();
+   ctSpinLockEnterCritical(registry.lock);
+   for (size_t i = 0; i < registry.arenas.Count(); i++) {
+      const ctFrameArenaStats stats = registry.arenas[i]->GetStats();
+      total.used += stats.used;
+      total.highWater += stats.highWater;
+      total.capacity += stats.capacity;
+      total.overflows += stats.overflows;
+   }
+   ctSpinLockExitCritical(registry.lock);
+   return total;
+}
+
+CT_API void* ctFrameArenaAlloc(ctFrameArena* pArena, size_t size, size_t alignment) {
+   return pArena->Alloc(size, alignment);
+}
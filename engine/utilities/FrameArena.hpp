@@ -0,0 +1,77 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+
+struct ctFrameArenaStats {
+   size_t used;       /* bytes handed out since the last reset */
+   size_t highWater;  /* most bytes used in a single frame */
+   size_t capacity;   /* bytes reserved across all blocks */
+   size_t overflows;  /* blocks chained because the first one ran out */
+};
+
+/*
+ * Bump allocator for memory that only lives until the end of the frame
+ * Allocations are never freed individually, Reset() reclaims everything at once.
+ * When a block runs out another one is chained on, on the next reset the chain is
+ * replaced by a single block big enough for the high water mark.
+ * Not thread safe, use ctGetFrameArena() to get the arena of the calling thread.
+ */
+class CT_API ctFrameArena {
+public:
+   ctFrameArena(size_t blockSize = 256 * 1024);
+   ctFrameArena(const ctFrameArena& arena) = delete;
+   ~ctFrameArena();
+
+   void* Alloc(size_t size, size_t alignment = 16);
+   template<class T>
+   inline T* Alloc(size_t count) {
+      return (T*)Alloc(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+   }
+   /* Invalidates everything allocated since the last reset */
+   void Reset();
+
+   ctFrameArenaStats GetStats() const;
+
+private:
+   struct Block {
+      Block* pNext;
+      size_t capacity;
+      size_t used;
+   };
+   Block* NewBlock(size_t capacity);
+   Block* pFirst;
+   Block* pCurrent;
+   size_t blockSize;
+   size_t used;
+   size_t highWater;
+   size_t capacity;
+   size_t overflows;
+};
+
+/* Arena of the calling thread, created on first use */
+CT_API ctFrameArena* ctGetFrameArena();
+/* Ends the frame for every thread arena (called by the engine at the end of a frame)
+ Nothing is freed here, frame memory of a thread stays valid until that thread calls
+ ctFrameArenaResetThread() at a point where it holds no frame memory. */
+CT_API void ctFrameArenaResetAll();
+/* Resets the arena of the calling thread if ctFrameArenaResetAll() ran since its last
+ reset, called between jobs and tasks and never while frame memory is still in use */
+CT_API void ctFrameArenaResetThread();
+/* Combined stats of every thread arena */
+CT_API ctFrameArenaStats ctFrameArenaGetTotalStats();
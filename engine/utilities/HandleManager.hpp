@@ -17,6 +17,7 @@
 #pragma once
 
 #include "utilities/Common.h"
+#include "utilities/Sync.hpp"
 
 typedef uint32_t ctHandle;
 
@@ -36,45 +37,140 @@ inline uint32_t ctHandleGetIndex(ctHandle hndl) {
    return rep.idx;
 }
 
+inline uint32_t ctHandleGetGeneration(ctHandle hndl) {
+   _ctInternalHandleRep rep;
+   rep.data = hndl;
+   return rep.gen;
+}
+
+inline ctHandle ctHandleMake(uint32_t index, uint32_t generation) {
+   _ctInternalHandleRep rep;
+   rep.data = 0;
+   rep.idx = index;
+   rep.gen = generation;
+   return rep.data;
+}
+
 inline bool ctHandleIsValid(ctHandle hndl) {
    _ctInternalHandleRep rep;
    rep.data = hndl;
    return rep.idx != 0;
 }
 
+#define CT_HANDLE_MAX_INDEX 0xFFFFFF
+
+/* Lock free, GetNewHandle() and FreeHandle() can be called from any thread.
+ Freed indices form a Treiber stack, the head packs the top index with a counter that
+ changes on every pop so a stale compare exchange can't succeed (ABA).
+ Links and generations are kept per index in chunks that double in size and never move,
+ new indices come from an atomic counter once the free list is empty. */
 class ctHandleManager {
 public:
-   inline ctHandleManager() {
-      _freeList = ctDynamicArray<_ctInternalHandleRep>();
-      _nextOpenIdx = 1; /* 1 is used for hashtable compatibility */
-   };
+   inline ctHandleManager();
+   ctHandleManager(const ctHandleManager& manager) = delete;
+   ctHandleManager& operator=(const ctHandleManager& manager) = delete;
+   inline ~ctHandleManager();
    inline ctHandle GetNewHandle();
    inline void FreeHandle(ctHandle hndl);
-   inline void Clear(); /* only do this if handles no-longer matter! */
+   /* only do this if handles no-longer matter and no other thread is using it! */
+   inline void Clear();
 
 private:
-   ctDynamicArray<_ctInternalHandleRep> _freeList;
-   unsigned int _nextOpenIdx;
+   struct FreeNode {
+      ctAtomic next;      /* index below on the free list (0: end) */
+      uint8_t generation; /* generation of the handle when it was freed */
+   };
+   /* chunk n holds 2^(n + firstChunkBits) indices */
+   static const uint32_t firstChunkBits = 8;
+   static const uint32_t chunkCount = 24 - firstChunkBits + 1;
+   static inline uint32_t _highestBit(uint32_t value);
+   inline FreeNode* _getNode(uint32_t index);
+
+   /* low 32 bits: top index, high 32 bits: pop count */
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _freeHead;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _nextOpenIdx;
+   ctAtomic64 _chunks[chunkCount];
 };
 
+inline ctHandleManager::ctHandleManager() {
+   ctAtomic64Set(_freeHead, 0);
+   ctAtomic64Set(_nextOpenIdx, 1); /* 1 is used for hashtable compatibility */
+   for (uint32_t i = 0; i < chunkCount; i++) {
+      ctAtomic64Set(_chunks[i], 0);
+   }
+}
+
+inline ctHandleManager::~ctHandleManager() {
+   for (uint32_t i = 0; i < chunkCount; i++) {
+      void* pChunk = (void*)(intptr_t)ctAtomic64Get(_chunks[i]);
+      if (pChunk) { ctFree(pChunk); }
+   }
+}
+
 inline ctHandle ctHandleManager::GetNewHandle() {
-   _ctInternalHandleRep result;
-   if (_freeList.isEmpty()) {
-      result = {_nextOpenIdx, 0};
-      _nextOpenIdx++;
-   } else {
-      result = _freeList.Last();
-      result.gen++;
-      _freeList.RemoveLast();
+   for (;;) {
+      const int64_t head = ctAtomic64Get(_freeHead);
+      const uint32_t index = (uint32_t)((uint64_t)head & 0xFFFFFFFF);
+      if (index == 0) { break; }
+      /* the node may be pushed again meanwhile, then the exchange below fails */
+      FreeNode* pNode = _getNode(index);
+      const uint64_t next = (uint32_t)ctAtomicGet(pNode->next);
+      const uint64_t popCount = ((uint64_t)head >> 32) + 1;
+      const int64_t desired = (int64_t)((popCount << 32) | next);
+      if (ctAtomic64CompareExchange(_freeHead, head, desired)) {
+         return ctHandleMake(index, (uint32_t)(uint8_t)(pNode->generation + 1));
+      }
    }
-   return result.data;
+   const int64_t index = ctAtomic64Add(_nextOpenIdx, 1);
+   ctAssert(index <= CT_HANDLE_MAX_INDEX);
+   return ctHandleMake((uint32_t)index, 0);
 }
+
 inline void ctHandleManager::FreeHandle(ctHandle hndl) {
-   _ctInternalHandleRep toInsert;
-   toInsert.data = hndl;
-   _freeList.Append(toInsert);
+   const uint32_t index = ctHandleGetIndex(hndl);
+   ctAssert(index != 0);
+   FreeNode* pNode = _getNode(index);
+   pNode->generation = (uint8_t)ctHandleGetGeneration(hndl);
+   for (;;) {
+      const int64_t head = ctAtomic64Get(_freeHead);
+      ctAtomicSet(pNode->next, (int)((uint64_t)head & 0xFFFFFFFF));
+      const uint64_t desired = ((uint64_t)head & 0xFFFFFFFF00000000) | index;
+      if (ctAtomic64CompareExchange(_freeHead, head, (int64_t)desired)) { return; }
+   }
 }
 
 inline void ctHandleManager::Clear() {
-   _freeList.Clear();
+   /* indices are not rewound, old handles can never match new ones */
+   ctAtomic64Set(_freeHead, 0);
+}
+
+inline uint32_t ctHandleManager::_highestBit(uint32_t value) {
+#if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanReverse(&index, value);
+   return (uint32_t)index;
+#else
+   return 31 - (uint32_t)__builtin_clz(value);
+#endif
+}
+
+inline ctHandleManager::FreeNode* ctHandleManager::_getNode(uint32_t index) {
+   const uint32_t biased = index + (1u << firstChunkBits);
+   const uint32_t chunk = _highestBit(biased) - firstChunkBits;
+   const uint32_t offset = biased - (1u << (chunk + firstChunkBits));
+   FreeNode* pChunk = (FreeNode*)(intptr_t)ctAtomic64Get(_chunks[chunk]);
+   if (!pChunk) {
+      /* first free in this range, whoever installs their chunk first wins */
+      const size_t size = sizeof(FreeNode) << (chunk + firstChunkBits);
+      FreeNode* pNew = (FreeNode*)ctMalloc(size);
+      ctAssert(pNew);
+      memset(pNew, 0, size);
+      if (ctAtomic64CompareExchange(_chunks[chunk], 0, (int64_t)(intptr_t)pNew)) {
+         pChunk = pNew;
+      } else {
+         ctFree(pNew);
+         pChunk = (FreeNode*)(intptr_t)ctAtomic64Get(_chunks[chunk]);
+      }
+   }
+   return &pChunk[offset];
 }
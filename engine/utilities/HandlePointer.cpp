@@ -65,7 +65,7 @@ ctHandlePtrGlobalPool* gGlobalHandlePtrPool = &_gGlobalHandlePoolLocalInstance;
 
 void _ctHandlePtrGlobalInit(size_t maxPointers) {
    ctSpinLockInit(gGlobalHandlePtrPool->lock);
-   gGlobalHandlePtrPool->handleManager = ctHandleManager();
+   gGlobalHandlePtrPool->handleManager.Clear();
    gGlobalHandlePtrPool->handleManager.GetNewHandle();
    gGlobalHandlePtrPool->maxPointers = maxPointers;
    gGlobalHandlePtrPool->pEntries = new ctHandlePtrEntry[maxPointers];
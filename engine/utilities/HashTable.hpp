@@ -17,19 +17,92 @@
 #pragma once
 
 #include "Common.h"
+#include "Allocator.hpp"
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define CT_HASH_TABLE_SSE2 1
+#else
+#define CT_HASH_TABLE_SSE2 0
+#endif
+
+/* See: https://abseil.io/about/design/swisstables
+ Open addressing over groups of 16 slots, each slot has a control byte holding 7 bits
+ of the mixed key hash (or empty/deleted) so a whole group is matched at once.
+ Groups are probed in triangular steps, a miss ends at the first group that still has
+ an empty slot and never looks further than the longest probe an insert needed.
+ Removed slots become tombstones unless their group has an empty slot, tombstones are
+ cleaned up when the table grows or rehashes.
+ Keys and values are zipped in their own arrays, value slots stay uninitialized until
+ an insert constructs them and are destroyed again on remove.
+ The same key can be inserted more than once, use occurance to reach the others.
+ A key value of 0 is reserved for empty items, make sure keys are never 0!
+ Storage comes from the Allocator policy (see Allocator.hpp). */
+#define CT_HASH_TABLE_GROUP_SIZE 16
+#define CT_HASH_TABLE_EMPTY      ((int8_t)-128)
+#define CT_HASH_TABLE_DELETED    ((int8_t)-2)
+
+/* Keys are integers that are often sequential (handles) or only vary in a few bits */
+template<class K>
+inline uint64_t ctHashTableMix(const K key) {
+   /* murmur3 finalizer */
+   uint64_t x = (uint64_t)key;
+   x ^= x >> 33;
+   x *= 0xff51afd7ed558ccdULL;
+   x ^= x >> 33;
+   x *= 0xc4ceb9fe1a85ec53ULL;
+   x ^= x >> 33;
+   return x;
+}
+
+/* Bit i is set for every slot of the group with the control byte */
+inline uint32_t ctHashTableGroupMatch(const int8_t* pGroup, const int8_t control) {
+#if CT_HASH_TABLE_SSE2
+   const __m128i group = _mm_load_si128((const __m128i*)pGroup);
+   return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(control)));
+#else
+   uint32_t mask = 0;
+   for (uint32_t i = 0; i < CT_HASH_TABLE_GROUP_SIZE; i++) {
+      if (pGroup[i] == control) { mask |= 1u << i; }
+   }
+   return mask;
+#endif
+}
+
+/* Bit i is set for every empty or deleted slot of the group */
+inline uint32_t ctHashTableGroupMatchFree(const int8_t* pGroup) {
+#if CT_HASH_TABLE_SSE2
+   return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i*)pGroup));
+#else
+   uint32_t mask = 0;
+   for (uint32_t i = 0; i < CT_HASH_TABLE_GROUP_SIZE; i++) {
+      if (pGroup[i] < 0) { mask |= 1u << i; }
+   }
+   return mask;
+#endif
+}
+
+inline uint32_t ctHashTableFirstBit(const uint32_t mask) {
+#if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return (uint32_t)index;
+#else
+   return (uint32_t)__builtin_ctz(mask);
+#endif
+}
 
-/* See: https://github.com/jamesroutley/write-a-hash-table.
- In this implementation we use open addressing instead of double hashing.
- Containers use zipped arrays instead of linked lists for performance.
- Collisions are expected to be resolved offline or by the key being a mask.
- Collision mitigation can also be done by the user with occurance retries.
- A key value of 0 is reserved for empty items, make sure keys are never 0! */
-template<class T, class K>
-class ctHashTable {
+template<class T, class K, class Allocator = ctHeapAllocator>
+class ctHashTable : private Allocator {
 public:
    ctHashTable();
-   ctHashTable(ctHashTable<T, K>& hmap);
-   ctHashTable(const ctHashTable<T, K>& hmap);
+   explicit ctHashTable(const Allocator& allocator);
+   ctHashTable(ctHashTable<T, K, Allocator>& hmap);
+   ctHashTable(const ctHashTable<T, K, Allocator>& hmap);
    ~ctHashTable();
    /* Key must never be 0! */
    T* Insert(const K key, const T& value);
@@ -41,7 +114,7 @@ public:
    T* InsertOrReplace(const K key, T&& value);
    T* FindPtr(const K key) const;
    T* FindPtr(const K key, const int occurance) const;
-   /* Does not call destructor or free for value! */
+   /* Destroys the value, anything it points to is not freed! */
    void Remove(const K key);
    void Clear();
    bool isEmpty() const;
@@ -49,10 +122,11 @@ public:
    size_t Count() const;
    size_t Capacity() const;
    ctResults Reserve(const size_t amount);
+   Allocator& GetAllocator();
 
    class Iterator {
    public:
-      Iterator(ctHashTable<T, K>* pTable);
+      Iterator(ctHashTable<T, K, Allocator>* pTable);
       T& Value() const;
       const K& Key() const;
       inline Iterator& operator++() {
@@ -72,7 +146,7 @@ public:
 
    private:
       inline void findNextValid();
-      ctHashTable<T, K>* pTable;
+      ctHashTable<T, K, Allocator>* pTable;
       size_t currentIdx;
    };
    /* Only call if not empty */
@@ -81,90 +155,170 @@ public:
    }
 
 private:
+   void _rehash(const size_t capacity);
+   void _release();
+   size_t _findSlot(const K key, const int occurance) const;
+   size_t _findFreeSlot(const uint64_t hash);
+   size_t _claimSlot(const K key);
+   void _destroyValues();
+   int8_t* _pControl;
    K* _pKeys;
    T* _pValues;
    size_t _capacity;
    size_t _count;
    size_t _baseSize;
+   /* inserts left before the table has to grow (tombstones don't give any back) */
+   size_t _growthLeft;
+   /* most groups any insert had to probe */
+   size_t _maxProbe;
 };
 
-template<class T, class K>
-inline ctHashTable<T, K>::ctHashTable() {
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::ctHashTable() {
+   _pControl = NULL;
    _pKeys = NULL;
    _pValues = NULL;
    _capacity = 0;
    _count = 0;
    _baseSize = 1;
+   _growthLeft = 0;
+   _maxProbe = 0;
 }
 
-template<class T, class K>
-inline ctHashTable<T, K>::ctHashTable(ctHashTable<T, K>& hmap) : ctHashTable() {
-   const size_t inputcount = hmap.Count();
-   Reserve(inputcount);
-   for (size_t i = 0; i < inputcount; i++) {
-      _pKeys[i] = hmap._pKeys[i];
-   }
-   for (size_t i = 0; i < inputcount; i++) {
-      _pValues[i] = hmap._pValues[i];
-   }
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::ctHashTable(const Allocator& allocator) :
+    Allocator(allocator) {
+   _pControl = NULL;
+   _pKeys = NULL;
+   _pValues = NULL;
+   _capacity = 0;
+   _count = 0;
+   _baseSize = 1;
+   _growthLeft = 0;
+   _maxProbe = 0;
 }
 
-template<class T, class K>
-inline ctHashTable<T, K>::ctHashTable(const ctHashTable<T, K>& hmap) {
-   const size_t inputcount = hmap.Count();
-   Reserve(inputcount);
-   for (size_t i = 0; i < inputcount; i++) {
-      _pKeys[i] = hmap._pKeys[i];
-   }
-   for (size_t i = 0; i < inputcount; i++) {
-      _pValues[i] = hmap._pValues[i];
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::ctHashTable(ctHashTable<T, K, Allocator>& hmap) :
+    ctHashTable((const ctHashTable<T, K, Allocator>&)hmap) {
+}
+
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::ctHashTable(
+  const ctHashTable<T, K, Allocator>& hmap) :
+    ctHashTable((const Allocator&)hmap) {
+   Reserve(hmap._baseSize);
+   for (size_t i = 0; i < hmap._capacity; i++) {
+      if (hmap._pControl[i] >= 0) { Insert(hmap._pKeys[i], hmap._pValues[i]); }
    }
 }
 
-template<class T, class K>
-inline ctHashTable<T, K>::~ctHashTable() {
-   if (_pKeys) { delete[] _pKeys; }
-   if (_pValues) { delete[] _pValues; }
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::~ctHashTable() {
+   _release();
 }
 
-#define _HASH_LOOP_BEGIN(_capacity_)                                                     \
-   for (K attempt = 0; attempt < _capacity_; attempt++) {                                \
-      const K idx = (key + attempt) % _capacity_;
-#define _HASH_LOOP_END }
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::_release() {
+   if (_pControl) {
+      _destroyValues();
+      Allocator::Free(_pControl, _capacity);
+      Allocator::Free(_pKeys, sizeof(K) * _capacity);
+      Allocator::Free(_pValues, sizeof(T) * _capacity);
+   }
+   _pControl = NULL;
+   _pKeys = NULL;
+   _pValues = NULL;
+}
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::Insert(const K key, const T& value) {
-   ZoneScoped;
-   if (key == 0) { return NULL; }
-   if (!_pKeys || !_pValues) { Reserve(31); }
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::_destroyValues() {
+   for (size_t i = 0; i < _capacity; i++) {
+      if (_pControl[i] >= 0) { _pValues[i].~T(); }
+   }
+}
 
-   /* Resize if needed */
-   size_t load = Count() * 100 / Capacity();
-   while (load > 70 || Count() >= Capacity()) {
-      Reserve(_baseSize * 2);
-      load = Count() * 100 / Capacity();
+template<class T, class K, class Allocator>
+inline size_t ctHashTable<T, K, Allocator>::_findSlot(const K key,
+                                                     const int occuranceTarget) const {
+   const uint64_t hash = ctHashTableMix(key);
+   const int8_t control = (int8_t)(hash & 0x7F);
+   const size_t groupMask = _capacity / CT_HASH_TABLE_GROUP_SIZE - 1;
+   size_t group = (size_t)(hash >> 7) & groupMask;
+   int occurance = 0;
+   for (size_t probe = 0; probe <= _maxProbe; probe++) {
+      const size_t base = group * CT_HASH_TABLE_GROUP_SIZE;
+      const int8_t* pGroup = &_pControl[base];
+      uint32_t match = ctHashTableGroupMatch(pGroup, control);
+      while (match) {
+         const size_t idx = base + ctHashTableFirstBit(match);
+         if (_pKeys[idx] == key) {
+            if (occurance == occuranceTarget) { return idx; }
+            occurance++;
+         }
+         match &= match - 1;
+      }
+      if (ctHashTableGroupMatch(pGroup, CT_HASH_TABLE_EMPTY)) { break; }
+      group = (group + probe + 1) & groupMask;
    }
+   return SIZE_MAX;
+}
 
-   /* Look for empty slot and insert */
-   _HASH_LOOP_BEGIN(Capacity()) {
-      if (_pKeys[idx] == 0) {
-         _pKeys[idx] = key;
-         _pValues[idx] = value;
-         _count++;
-         return &_pValues[idx];
+template<class T, class K, class Allocator>
+inline size_t ctHashTable<T, K, Allocator>::_findFreeSlot(const uint64_t hash) {
+   const size_t groupMask = _capacity / CT_HASH_TABLE_GROUP_SIZE - 1;
+   size_t group = (size_t)(hash >> 7) & groupMask;
+   for (size_t probe = 0;; probe++) {
+      const size_t base = group * CT_HASH_TABLE_GROUP_SIZE;
+      const uint32_t free = ctHashTableGroupMatchFree(&_pControl[base]);
+      if (free) {
+         if (probe > _maxProbe) { _maxProbe = probe; }
+         return base + ctHashTableFirstBit(free);
       }
-      _HASH_LOOP_END
+      /* the load limit keeps free slots around so this always ends */
+      group = (group + probe + 1) & groupMask;
    }
-   return NULL;
 }
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::Insert(const K key, T&& value) {
-   return Insert(key, value);
+/* Value is left for the caller to construct */
+template<class T, class K, class Allocator>
+inline size_t ctHashTable<T, K, Allocator>::_claimSlot(const K key) {
+   if (!_pControl) { Reserve(31); }
+   while (_growthLeft == 0) {
+      /* mostly tombstones: clean up in place, otherwise grow */
+      if (_count * 2 < _capacity * 7 / 8) {
+         _rehash(_capacity);
+      } else {
+         Reserve(_baseSize * 2);
+      }
+   }
+   const uint64_t hash = ctHashTableMix(key);
+   const size_t idx = _findFreeSlot(hash);
+   if (_pControl[idx] == CT_HASH_TABLE_EMPTY) { _growthLeft--; }
+   _pControl[idx] = (int8_t)(hash & 0x7F);
+   _pKeys[idx] = key;
+   _count++;
+   return idx;
+}
+
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::Insert(const K key, const T& value) {
+   ZoneScoped;
+   if (key == 0) { return NULL; }
+   const size_t idx = _claimSlot(key);
+   return new (&_pValues[idx]) T(value);
+}
+
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::Insert(const K key, T&& value) {
+   ZoneScoped;
+   if (key == 0) { return NULL; }
+   const size_t idx = _claimSlot(key);
+   return new (&_pValues[idx]) T(ctMove(value));
 }
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::InsertOrReplace(const K key, const T& value) {
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::InsertOrReplace(const K key, const T& value) {
    T* existing = FindPtr(key);
    if (existing) {
       *existing = value;
@@ -173,135 +327,163 @@ inline T* ctHashTable<T, K>::InsertOrReplace(const K key, const T& value) {
    return Insert(key, value);
 }
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::InsertOrReplace(const K key, T&& value) {
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::InsertOrReplace(const K key, T&& value) {
    T* existing = FindPtr(key);
    if (existing) {
-      *existing = value;
+      *existing = ctMove(value);
       return existing;
    }
-   return Insert(key, value);
+   return Insert(key, ctMove(value));
 }
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::FindPtr(const K key) const {
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::FindPtr(const K key) const {
    return FindPtr(key, 0);
 }
 
-template<class T, class K>
-inline T* ctHashTable<T, K>::FindPtr(const K key, const int occuranceTarget) const {
+template<class T, class K, class Allocator>
+inline T* ctHashTable<T, K, Allocator>::FindPtr(const K key,
+                                                const int occuranceTarget) const {
    ZoneScoped;
    if (key == 0) { return NULL; }
-   if (!_pKeys || !_pValues) { return NULL; }
-   int occurance = 0;
-   _HASH_LOOP_BEGIN(Capacity()) {
-      if (_pKeys[idx] == key) {
-         if (occurance == occuranceTarget) { return &_pValues[idx]; }
-         occurance++;
-      }
-      _HASH_LOOP_END
-   }
-   return NULL;
+   if (!_pControl) { return NULL; }
+   const size_t idx = _findSlot(key, occuranceTarget);
+   return idx != SIZE_MAX ? &_pValues[idx] : NULL;
 }
 
-template<class T, class K>
-inline void ctHashTable<T, K>::Remove(const K key) {
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::Remove(const K key) {
    ZoneScoped;
    if (key == 0) { return; }
-   if (!_pKeys || !_pValues) { return; }
-   _HASH_LOOP_BEGIN(Capacity()) {
-      if (_pKeys[idx] == key) {
-         _pKeys[idx] = 0;
-         _count--;
-         return;
-      }
-      _HASH_LOOP_END
+   if (!_pControl) { return; }
+   const size_t idx = _findSlot(key, 0);
+   if (idx == SIZE_MAX) { return; }
+   /* a group with an empty slot never made a probe move past it */
+   const size_t base = idx & ~(size_t)(CT_HASH_TABLE_GROUP_SIZE - 1);
+   if (ctHashTableGroupMatch(&_pControl[base], CT_HASH_TABLE_EMPTY)) {
+      _pControl[idx] = CT_HASH_TABLE_EMPTY;
+      _growthLeft++;
+   } else {
+      _pControl[idx] = CT_HASH_TABLE_DELETED;
    }
+   _pKeys[idx] = 0;
+   _pValues[idx].~T();
+   _count--;
 }
 
-template<class T, class K>
-inline void ctHashTable<T, K>::Clear() {
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::Clear() {
+   if (!_pControl) { return; }
+   _destroyValues();
+   memset(_pControl, CT_HASH_TABLE_EMPTY, _capacity);
    memset(_pKeys, 0, sizeof(K) * _capacity);
    _count = 0;
+   _growthLeft = _capacity * 7 / 8;
+   _maxProbe = 0;
 }
 
-template<class T, class K>
-inline bool ctHashTable<T, K>::isEmpty() const {
+template<class T, class K, class Allocator>
+inline bool ctHashTable<T, K, Allocator>::isEmpty() const {
    return _count == 0;
 }
 
-template<class T, class K>
-inline bool ctHashTable<T, K>::Exists(const K key) const {
+template<class T, class K, class Allocator>
+inline bool ctHashTable<T, K, Allocator>::Exists(const K key) const {
    return (FindPtr(key) != NULL);
 }
 
-template<class T, class K>
-inline size_t ctHashTable<T, K>::Count() const {
+template<class T, class K, class Allocator>
+inline size_t ctHashTable<T, K, Allocator>::Count() const {
    return _count;
 }
 
-template<class T, class K>
-inline size_t ctHashTable<T, K>::Capacity() const {
+template<class T, class K, class Allocator>
+inline size_t ctHashTable<T, K, Allocator>::Capacity() const {
    return _capacity;
 }
 
-template<class T, class K>
-inline ctResults ctHashTable<T, K>::Reserve(const size_t baseSize) {
+template<class T, class K, class Allocator>
+inline ctResults ctHashTable<T, K, Allocator>::Reserve(const size_t baseSize) {
    if (baseSize <= _baseSize) { return CT_SUCCESS; }
    _baseSize = baseSize;
+   /* power of two groups kept at most 7/8 full */
+   size_t capacity = CT_HASH_TABLE_GROUP_SIZE;
+   while (capacity * 7 / 8 < baseSize) {
+      capacity *= 2;
+   }
+   if (capacity > _capacity) { _rehash(capacity); }
+   return CT_SUCCESS;
+}
 
-   T* oldValues = _pValues;
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::_rehash(const size_t capacity) {
+   ZoneScoped;
+   int8_t* oldControl = _pControl;
    K* oldKeys = _pKeys;
-   size_t oldCapacity = _capacity;
+   T* oldValues = _pValues;
+   const size_t oldCapacity = _capacity;
 
-   size_t capacity = ctNextPrime(baseSize);
-   _pValues = new T[capacity];
-   _pKeys = new K[capacity];
+   _pControl = (int8_t*)Allocator::Allocate(capacity, CT_HASH_TABLE_GROUP_SIZE);
+   _pKeys = (K*)Allocator::Allocate(sizeof(K) * capacity, alignof(K));
+   _pValues = (T*)Allocator::Allocate(sizeof(T) * capacity, alignof(T));
+   ctAssert(_pControl && _pKeys && _pValues);
+   memset(_pControl, CT_HASH_TABLE_EMPTY, capacity);
    memset(_pKeys, 0, sizeof(K) * capacity);
    _capacity = capacity;
    _count = 0;
+   _growthLeft = capacity * 7 / 8;
+   _maxProbe = 0;
 
-   if (!oldKeys || !oldValues) { return CT_SUCCESS; }
-
+   if (!oldControl) { return; }
    for (size_t i = 0; i < oldCapacity; i++) {
-      if (oldKeys[i] != 0) { Insert(oldKeys[i], oldValues[i]); }
+      if (oldControl[i] < 0) { continue; }
+      const uint64_t hash = ctHashTableMix(oldKeys[i]);
+      const size_t idx = _findFreeSlot(hash);
+      _growthLeft--;
+      _pControl[idx] = (int8_t)(hash & 0x7F);
+      _pKeys[idx] = oldKeys[i];
+      new (&_pValues[idx]) T(ctMove(oldValues[i]));
+      oldValues[i].~T();
+      _count++;
    }
-
-   delete[] oldValues;
-   delete[] oldKeys;
-
-   return CT_SUCCESS;
+   Allocator::Free(oldControl, oldCapacity);
+   Allocator::Free(oldKeys, sizeof(K) * oldCapacity);
+   Allocator::Free(oldValues, sizeof(T) * oldCapacity);
 }
 
-template<class T, class K>
-inline ctHashTable<T, K>::Iterator::Iterator(ctHashTable<T, K>* _pTable) {
-   ctAssert(pTable);
+template<class T, class K, class Allocator>
+inline ctHashTable<T, K, Allocator>::Iterator::Iterator(
+  ctHashTable<T, K, Allocator>* _pTable) {
+   ctAssert(_pTable);
    pTable = _pTable;
    currentIdx = 0;
    findNextValid();
 }
 
-template<class T, class K>
-inline T& ctHashTable<T, K>::Iterator::Value() const {
+template<class T, class K, class Allocator>
+inline T& ctHashTable<T, K, Allocator>::Iterator::Value() const {
    ctAssert(pTable);
    ctAssert(currentIdx < pTable->_capacity);
    return pTable->_pValues[currentIdx];
 }
 
-template<class T, class K>
-inline const K& ctHashTable<T, K>::Iterator::Key() const {
+template<class T, class K, class Allocator>
+inline const K& ctHashTable<T, K, Allocator>::Iterator::Key() const {
    ctAssert(pTable);
    ctAssert(currentIdx < pTable->_capacity);
    return pTable->_pKeys[currentIdx];
 }
 
-template<class T, class K>
-inline void ctHashTable<T, K>::Iterator::findNextValid() {
+template<class T, class K, class Allocator>
+inline void ctHashTable<T, K, Allocator>::Iterator::findNextValid() {
    ZoneScoped;
-   if (currentIdx < pTable->_capacity) {
-      while (pTable->_pKeys[currentIdx] == 0) {
-         currentIdx++;
-         if (currentIdx >= pTable->_capacity) { break; }
-      }
+   while (currentIdx < pTable->_capacity && pTable->_pControl[currentIdx] < 0) {
+      currentIdx++;
    }
-}
\ No newline at end of file
+}
+
+template<class T, class K, class Allocator>
+inline Allocator& ctHashTable<T, K, Allocator>::GetAllocator() {
+   return *this;
+}
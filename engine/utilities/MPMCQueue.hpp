@@ -0,0 +1,179 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+#include "Allocator.hpp"
+#include <new>
+
+/* See: "Bounded MPMC queue" (Dmitry Vyukov, 1024cores.net)
+ Bounded lock free queue for any number of producers and consumers.
+ Every cell carries a sequence number that says whose turn it is: a producer may fill
+ cell (pos & mask) once its sequence equals pos, a consumer may empty it once it
+ equals pos + 1, releasing it sets it to pos + capacity for the next lap.
+ Threads only contend on the enqueue or dequeue position, never on a lock.
+ Capacity is fixed at creation and must be a power of two, Push() fails when full. */
+template<class T>
+class ctMPMCQueue {
+public:
+   ctMPMCQueue();
+   ctMPMCQueue(const ctMPMCQueue<T>& queue) = delete;
+   ~ctMPMCQueue();
+
+   ctResults Reserve(const size_t capacity);
+
+   /* Any thread */
+   bool Push(const T& val);
+   /* Any thread */
+   bool Push(T&& val);
+   /* Any thread */
+   bool Pop(T& out);
+
+   /* Approximate when called while the queue is in use */
+   size_t Count();
+   size_t Capacity() const;
+   bool isEmpty();
+
+private:
+   struct Cell {
+      ctAtomic64 sequence;
+      CT_ALIGN(alignof(T)) uint8_t data[sizeof(T)];
+   };
+   Cell* _claimPush(int64_t& pos);
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _enqueuePos;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _dequeuePos;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) Cell* _pCells;
+   int64_t _mask;
+};
+
+template<class T>
+inline ctMPMCQueue<T>::ctMPMCQueue() {
+   ctAtomic64Set(_enqueuePos, 0);
+   ctAtomic64Set(_dequeuePos, 0);
+   _pCells = NULL;
+   _mask = 0;
+}
+
+template<class T>
+inline ctMPMCQueue<T>::~ctMPMCQueue() {
+   if (!_pCells) { return; }
+   const int64_t enqueuePos = ctAtomic64Get(_enqueuePos);
+   for (int64_t i = ctAtomic64Get(_dequeuePos); i < enqueuePos; i++) {
+      ((T*)_pCells[i & _mask].data)->~T();
+   }
+   ctAlignedFree(_pCells);
+   _pCells = NULL;
+}
+
+template<class T>
+inline ctResults ctMPMCQueue<T>::Reserve(const size_t capacity) {
+   if (_pCells) { return CT_FAILURE_NOT_UPDATABLE; }
+   if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+      return CT_FAILURE_INVALID_PARAMETER;
+   }
+   _pCells = (Cell*)ctAlignedMalloc(sizeof(Cell) * capacity, CT_ALIGNMENT_CACHE);
+   if (!_pCells) { return CT_FAILURE_OUT_OF_MEMORY; }
+   for (size_t i = 0; i < capacity; i++) {
+      ctAtomic64Set(_pCells[i].sequence, (int64_t)i);
+   }
+   _mask = (int64_t)capacity - 1;
+   return CT_SUCCESS;
+}
+
+/* Cell the caller now owns and has to publish, NULL when full */
+template<class T>
+inline typename ctMPMCQueue<T>::Cell* ctMPMCQueue<T>::_claimPush(int64_t& pos) {
+   ctAssert(_pCells);
+   pos = ctAtomic64GetAcquire(_enqueuePos);
+   for (;;) {
+      Cell* pCell = &_pCells[pos & _mask];
+      const int64_t diff = ctAtomic64GetAcquire(pCell->sequence) - pos;
+      if (diff == 0) {
+         if (ctAtomic64CompareExchange(_enqueuePos, pos, pos + 1)) { return pCell; }
+         pos = ctAtomic64GetAcquire(_enqueuePos);
+      } else if (diff < 0) {
+         /* a lap behind: still holds an item nobody popped */
+         return NULL;
+      } else {
+         /* another producer took it */
+         pos = ctAtomic64GetAcquire(_enqueuePos);
+      }
+   }
+}
+
+template<class T>
+inline bool ctMPMCQueue<T>::Push(const T& val) {
+   int64_t pos;
+   Cell* pCell = _claimPush(pos);
+   if (!pCell) { return false; }
+   new (pCell->data) T(val);
+   ctAtomic64SetRelease(pCell->sequence, pos + 1);
+   return true;
+}
+
+template<class T>
+inline bool ctMPMCQueue<T>::Push(T&& val) {
+   int64_t pos;
+   Cell* pCell = _claimPush(pos);
+   if (!pCell) { return false; }
+   new (pCell->data) T(ctMove(val));
+   ctAtomic64SetRelease(pCell->sequence, pos + 1);
+   return true;
+}
+
+template<class T>
+inline bool ctMPMCQueue<T>::Pop(T& out) {
+   ctAssert(_pCells);
+   int64_t pos = ctAtomic64GetAcquire(_dequeuePos);
+   Cell* pCell;
+   for (;;) {
+      pCell = &_pCells[pos & _mask];
+      const int64_t diff = ctAtomic64GetAcquire(pCell->sequence) - (pos + 1);
+      if (diff == 0) {
+         if (ctAtomic64CompareExchange(_dequeuePos, pos, pos + 1)) { break; }
+         pos = ctAtomic64GetAcquire(_dequeuePos);
+      } else if (diff < 0) {
+         /* not filled yet */
+         return false;
+      } else {
+         /* another consumer took it */
+         pos = ctAtomic64GetAcquire(_dequeuePos);
+      }
+   }
+   T* pItem = (T*)pCell->data;
+   out = ctMove(*pItem);
+   pItem->~T();
+   ctAtomic64SetRelease(pCell->sequence, pos + _mask + 1);
+   return true;
+}
+
+template<class T>
+inline size_t ctMPMCQueue<T>::Count() {
+   const int64_t count =
+     ctAtomic64GetAcquire(_enqueuePos) - ctAtomic64GetAcquire(_dequeuePos);
+   return count > 0 ? (size_t)count : 0;
+}
+
+template<class T>
+inline size_t ctMPMCQueue<T>::Capacity() const {
+   return _pCells ? (size_t)_mask + 1 : 0;
+}
+
+template<class T>
+inline bool ctMPMCQueue<T>::isEmpty() {
+   return Count() == 0;
+}
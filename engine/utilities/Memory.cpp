@@ -15,63 +15,470 @@
 */
 
 #include "Common.h"
+#include "system/System.h"
 
 struct alignedAllocTracker {
    void* rawMemory;
    size_t originalSize;
+   uint32_t tag;
 };
 
 ctAtomic gAllocCount = ctAtomic();
 
+/* ------------- Memory Tags ------------- */
+
+#define CT_MEMORY_TAG_STACK_SIZE 16
+
+static const char* gMemoryTagNames[CT_MEMORY_TAG_COUNT] = {"General",
+                                                          "Core",
+                                                          "Resource",
+                                                          "Renderer",
+                                                          "Physics",
+                                                          "Animation",
+                                                          "Scene",
+                                                          "UI",
+                                                          "Interact",
+                                                          "Audition",
+                                                          "Game"};
+
+struct ctMemoryTagCounters {
+   ctAtomic64 bytes;
+   ctAtomic64 count;
+   ctAtomic64 highWater;
+};
+static ctMemoryTagCounters gMemoryTags[CT_MEMORY_TAG_COUNT];
+
+static void ctMemoryTagAccount(int tag, int64_t bytes, int64_t count) {
+   ctMemoryTagCounters& counters = gMemoryTags[tag];
+   ctAtomic64Add(counters.count, count);
+   const int64_t total = ctAtomic64Add(counters.bytes, bytes) + bytes;
+   int64_t peak = ctAtomic64Get(counters.highWater);
+   while (total > peak && !ctAtomic64CompareExchange(counters.highWater, peak, total)) {
+      peak = ctAtomic64Get(counters.highWater);
+   }
+}
+
+/* ------------- Small Object Pools ------------- */
+
+/* Allocations up to CT_POOL_MAX_SIZE come from size class slabs instead of malloc.
+ Classes below a cache line are 16 byte aligned, the rest are multiples of it.
+ Slabs are aligned to their size so the slab of a block is found by masking, a radix
+ map of every slab address tells pooled blocks apart from the tracked ones.
+ Each thread caches free blocks per class and trades them with the shared lists in
+ batches, so most allocations never take a lock. Slabs are never given back. */
+#define CT_POOL_SLAB_SHIFT  16
+#define CT_POOL_SLAB_SIZE   ((size_t)1 << CT_POOL_SLAB_SHIFT)
+#define CT_POOL_CHUNK_SLABS 16
+#define CT_POOL_MAX_SIZE    512
+#define CT_POOL_CLASS_COUNT 11
+#define CT_POOL_BATCH       32
+
+static const size_t gPoolClassSizes[CT_POOL_CLASS_COUNT] = {
+  16, 32, 48, 64, 128, 192, 256, 320, 384, 448, 512};
+
+static inline int ctPoolClassIndex(size_t size) {
+   if (size <= 16) { return 0; }
+   if (size <= 64) { return (int)((size - 1) >> 4); }
+   return (int)((size + 63) >> 6) + 2;
+}
+
+/* slabs only ever hold blocks of one class and tag */
+struct ctPoolSlabHeader {
+   int32_t classIndex;
+   int32_t tag;
+};
+
+struct ctPoolFreeBlock {
+   ctPoolFreeBlock* pNext;
+};
+
+struct ctPoolClass {
+   ctSpinLock lock;
+   ctPoolFreeBlock* pFree;
+   size_t freeCount;
+   /* untouched remainder of the newest slab */
+   uint8_t* pCarve;
+   uint8_t* pCarveEnd;
+};
+static ctPoolClass gPoolClasses[CT_MEMORY_TAG_COUNT][CT_POOL_CLASS_COUNT];
+
+/* slabs carved from a chunk but not yet given to a class */
+static ctSpinLock gPoolSlabLock;
+static uint8_t* gPoolSpareSlabs[CT_POOL_CHUNK_SLABS];
+static size_t gPoolSpareCount = 0;
+
+/* one byte per slab, indexed by the upper and middle address bits */
+static uint8_t* volatile gPoolSlabMap[(size_t)1 << 16];
+
+static inline bool ctPoolOwns(const void* block) {
+   const uintptr_t address = (uintptr_t)block;
+   const uint8_t* pLeaf = gPoolSlabMap[(address >> 32) & 0xFFFF];
+   if (!pLeaf) { return false; }
+   return pLeaf[(address >> CT_POOL_SLAB_SHIFT) & 0xFFFF] != 0;
+}
+
+static inline ctPoolSlabHeader* ctPoolGetSlab(const void* block) {
+   return (ctPoolSlabHeader*)((uintptr_t)block & ~(uintptr_t)(CT_POOL_SLAB_SIZE - 1));
+}
+
+static uint8_t* ctPoolNewSlab() {
+   ZoneScoped;
+   ctSpinLockEnterCritical(gPoolSlabLock);
+   if (gPoolSpareCount == 0) {
+      const size_t chunkSize = CT_POOL_SLAB_SIZE * (CT_POOL_CHUNK_SLABS + 1);
+      uint8_t* pChunk = (uint8_t*)malloc(chunkSize);
+      if (!pChunk) {
+         ctSpinLockExitCritical(gPoolSlabLock);
+         return NULL;
+      }
+      TracyAlloc(pChunk, chunkSize);
+      uint8_t* pSlab =
+        (uint8_t*)ctAlign((uintptr_t)pChunk, (uintptr_t)CT_POOL_SLAB_SIZE);
+      for (size_t i = 0; i < CT_POOL_CHUNK_SLABS; i++) {
+         gPoolSpareSlabs[gPoolSpareCount++] = pSlab;
+         pSlab += CT_POOL_SLAB_SIZE;
+      }
+   }
+   uint8_t* pSlab = gPoolSpareSlabs[--gPoolSpareCount];
+   const uintptr_t address = (uintptr_t)pSlab;
+   uint8_t* pLeaf = gPoolSlabMap[(address >> 32) & 0xFFFF];
+   if (!pLeaf) {
+      pLeaf = (uint8_t*)calloc((size_t)1 << 16, 1);
+      ctAssert(pLeaf);
+      gPoolSlabMap[(address >> 32) & 0xFFFF] = pLeaf;
+   }
+   pLeaf[(address >> CT_POOL_SLAB_SHIFT) & 0xFFFF] = 1;
+   ctSpinLockExitCritical(gPoolSlabLock);
+   return pSlab;
+}
+
+/* links up to count blocks of the class for a thread cache */
+static size_t
+ctPoolTakeBatch(int tag, int classIndex, ctPoolFreeBlock** ppOut, size_t count) {
+   ctPoolClass& poolClass = gPoolClasses[tag][classIndex];
+   const size_t blockSize = gPoolClassSizes[classIndex];
+   ctPoolFreeBlock* pList = NULL;
+   size_t taken = 0;
+   ctSpinLockEnterCritical(poolClass.lock);
+   while (taken < count && poolClass.pFree) {
+      ctPoolFreeBlock* pBlock = poolClass.pFree;
+      poolClass.pFree = pBlock->pNext;
+      poolClass.freeCount--;
+      pBlock->pNext = pList;
+      pList = pBlock;
+      taken++;
+   }
+   while (taken < count) {
+      if (poolClass.pCarve + blockSize > poolClass.pCarveEnd) {
+         uint8_t* pSlab = ctPoolNewSlab();
+         if (!pSlab) { break; }
+         ((ctPoolSlabHeader*)pSlab)->classIndex = classIndex;
+         ((ctPoolSlabHeader*)pSlab)->tag = tag;
+         poolClass.pCarve = pSlab + CT_ALIGNMENT_CACHE;
+         poolClass.pCarveEnd = pSlab + CT_POOL_SLAB_SIZE;
+      }
+      ctPoolFreeBlock* pBlock = (ctPoolFreeBlock*)poolClass.pCarve;
+      poolClass.pCarve += blockSize;
+      pBlock->pNext = pList;
+      pList = pBlock;
+      taken++;
+   }
+   ctSpinLockExitCritical(poolClass.lock);
+   *ppOut = pList;
+   return taken;
+}
+
+static void
+ctPoolGiveBatch(int tag, int classIndex, ctPoolFreeBlock* pList, size_t count) {
+   if (!pList) { return; }
+   ctPoolFreeBlock* pLast = pList;
+   while (pLast->pNext) {
+      pLast = pLast->pNext;
+   }
+   ctPoolClass& poolClass = gPoolClasses[tag][classIndex];
+   ctSpinLockEnterCritical(poolClass.lock);
+   pLast->pNext = poolClass.pFree;
+   poolClass.pFree = pList;
+   poolClass.freeCount += count;
+   ctSpinLockExitCritical(poolClass.lock);
+}
+
+/* plain data so it needs no guard, see ctPoolThreadFlusher for cleanup */
+struct ctPoolThreadCache {
+   ctPoolFreeBlock* pFree[CT_MEMORY_TAG_COUNT][CT_POOL_CLASS_COUNT];
+   size_t freeCount[CT_MEMORY_TAG_COUNT][CT_POOL_CLASS_COUNT];
+   int64_t tagBytesDelta[CT_MEMORY_TAG_COUNT];
+   int64_t tagCountDelta[CT_MEMORY_TAG_COUNT];
+   int32_t aliveDelta;
+   uint8_t tagStack[CT_MEMORY_TAG_STACK_SIZE];
+   int32_t tagDepth;
+   bool exited;
+   bool registered;
+};
+static thread_local ctPoolThreadCache tPoolCache;
+
+static inline int ctMemoryTagGetLocal(const ctPoolThreadCache& cache) {
+   return cache.tagDepth ? cache.tagStack[cache.tagDepth - 1] : CT_MEMORY_TAG_GENERAL;
+}
+
+static inline void ctPoolFlushStats(ctPoolThreadCache& cache, int tag) {
+   if (cache.aliveDelta) {
+      ctAtomicAdd(gAllocCount, cache.aliveDelta);
+      cache.aliveDelta = 0;
+   }
+   if (cache.tagCountDelta[tag] || cache.tagBytesDelta[tag]) {
+      ctMemoryTagAccount(tag, cache.tagBytesDelta[tag], cache.tagCountDelta[tag]);
+      cache.tagBytesDelta[tag] = 0;
+      cache.tagCountDelta[tag] = 0;
+   }
+}
+
+/* hands the cached blocks back when the thread exits */
+struct ctPoolThreadFlusher {
+   ~ctPoolThreadFlusher() {
+      ctPoolThreadCache& cache = tPoolCache;
+      for (int tag = 0; tag < CT_MEMORY_TAG_COUNT; tag++) {
+         for (int i = 0; i < CT_POOL_CLASS_COUNT; i++) {
+            ctPoolGiveBatch(tag, i, cache.pFree[tag][i], cache.freeCount[tag][i]);
+            cache.pFree[tag][i] = NULL;
+            cache.freeCount[tag][i] = 0;
+         }
+         ctPoolFlushStats(cache, tag);
+      }
+      /* anything freed later on this thread goes straight to the shared lists */
+      cache.exited = true;
+   }
+};
+static thread_local ctPoolThreadFlusher tPoolFlusher;
+
+static inline ctPoolThreadCache& ctPoolGetThreadCache() {
+   ctPoolThreadCache& cache = tPoolCache;
+   if (!cache.registered) {
+      /* touching it registers the destructor */
+      (void)&tPoolFlusher;
+      cache.registered = true;
+   }
+   return cache;
+}
+
+/* tracked blocks take the pending pooled counts along so high water marks see them */
+static inline void ctMemoryTagAccountTracked(int tag, int64_t bytes, int64_t count) {
+   ctPoolThreadCache& cache = tPoolCache;
+   cache.tagBytesDelta[tag] += bytes;
+   cache.tagCountDelta[tag] += count;
+   ctPoolFlushStats(cache, tag);
+}
+
+static void* ctPoolAlloc(size_t size) {
+   const int classIndex = ctPoolClassIndex(size);
+   const int64_t blockSize = (int64_t)gPoolClassSizes[classIndex];
+   ctPoolThreadCache& cache = ctPoolGetThreadCache();
+   const int tag = ctMemoryTagGetLocal(cache);
+   ctPoolFreeBlock*& pFree = cache.pFree[tag][classIndex];
+   if (!pFree || cache.exited) {
+      ctPoolFreeBlock* pList = NULL;
+      const size_t count = ctPoolTakeBatch(
+        tag, classIndex, &pList, cache.exited ? 1 : (size_t)CT_POOL_BATCH);
+      if (!count) { return NULL; }
+      if (cache.exited) {
+         ctAtomicAdd(gAllocCount, 1);
+         ctMemoryTagAccount(tag, blockSize, 1);
+         return pList;
+      }
+      pFree = pList;
+      cache.freeCount[tag][classIndex] = count;
+      ctPoolFlushStats(cache, tag);
+   }
+   ctPoolFreeBlock* pBlock = pFree;
+   pFree = pBlock->pNext;
+   cache.freeCount[tag][classIndex]--;
+   cache.aliveDelta++;
+   cache.tagBytesDelta[tag] += blockSize;
+   cache.tagCountDelta[tag]++;
+   return pBlock;
+}
+
+static void ctPoolFree(void* block) {
+   const ctPoolSlabHeader* pSlab = ctPoolGetSlab(block);
+   const int classIndex = pSlab->classIndex;
+   const int tag = pSlab->tag;
+   const int64_t blockSize = (int64_t)gPoolClassSizes[classIndex];
+   ctPoolFreeBlock* pBlock = (ctPoolFreeBlock*)block;
+   ctPoolThreadCache& cache = ctPoolGetThreadCache();
+   if (cache.exited) {
+      pBlock->pNext = NULL;
+      ctPoolGiveBatch(tag, classIndex, pBlock, 1);
+      ctAtomicAdd(gAllocCount, -1);
+      ctMemoryTagAccount(tag, -blockSize, -1);
+      return;
+   }
+   ctPoolFreeBlock*& pFree = cache.pFree[tag][classIndex];
+   size_t& freeCount = cache.freeCount[tag][classIndex];
+   pBlock->pNext = pFree;
+   pFree = pBlock;
+   freeCount++;
+   cache.aliveDelta--;
+   cache.tagBytesDelta[tag] -= blockSize;
+   cache.tagCountDelta[tag]--;
+   if (freeCount >= CT_POOL_BATCH * 2) {
+      /* keep the newest half, return the rest */
+      ctPoolFreeBlock* pKeepLast = pFree;
+      for (size_t i = 1; i < CT_POOL_BATCH; i++) {
+         pKeepLast = pKeepLast->pNext;
+      }
+      ctPoolFreeBlock* pGive = pKeepLast->pNext;
+      pKeepLast->pNext = NULL;
+      ctPoolGiveBatch(tag, classIndex, pGive, freeCount - CT_POOL_BATCH);
+      freeCount = CT_POOL_BATCH;
+      ctPoolFlushStats(cache, tag);
+   }
+}
+
+static inline size_t ctGetBlockSize(void* block) {
+   if (ctPoolOwns(block)) { return gPoolClassSizes[ctPoolGetSlab(block)->classIndex]; }
+   return ((alignedAllocTracker*)block)[-1].originalSize;
+}
+
+/* ------------- Tracked Allocations ------------- */
+
 void* ctAlignedMalloc(size_t size, size_t alignment) {
    ZoneScoped;
    const size_t allocSize = size + alignment + sizeof(alignedAllocTracker);
    char* rawMemory = (char*)malloc(allocSize);
-   TracyAlloc(rawMemory, allocSize);
+   const int tag = ctMemoryTagGetLocal(tPoolCache);
+   TracyAllocN(rawMemory, allocSize, gMemoryTagNames[tag]);
    ctAtomicAdd(gAllocCount, 1);
+   ctMemoryTagAccountTracked(tag, (int64_t)size, 1);
    alignedAllocTracker* ptr =
      (alignedAllocTracker*)((uintptr_t)(rawMemory + alignment +
                                         sizeof(alignedAllocTracker)) &
                             ~(alignment - 1));
-   ptr[-1] = {(void*)rawMemory, size};
+   ptr[-1] = {(void*)rawMemory, size, (uint32_t)tag};
    return (void*)ptr;
 }
 
 void* ctAlignedRealloc(void* block, size_t size, size_t alignment) {
    ZoneScoped;
-   void* pNew = ctAlignedMalloc(size, alignment);
-   if (block) {
-      memcpy(pNew, block, ((alignedAllocTracker*)block)[-1].originalSize);
+   if (!block) { return ctAlignedMalloc(size, alignment); }
+   const size_t oldSize = ctGetBlockSize(block);
+   const bool isPooled = ctPoolOwns(block);
+   const bool isAligned = ((uintptr_t)block & (alignment - 1)) == 0;
+   if (isPooled || !isAligned) {
+      /* pooled blocks that still fit keep their slot, everything else moves */
+      if (isPooled && isAligned && size <= oldSize) { return block; }
+      void* pNew = ctAlignedMalloc(size, alignment);
+      memcpy(pNew, block, oldSize < size ? oldSize : size);
       ctAlignedFree(block);
+      return pNew;
+   }
+
+   /* let the system grow or shrink it in place (or remap it) when it can,
+    the aligned start can land at a different offset so the data may shift */
+   void* pOldRaw = ((alignedAllocTracker*)block)[-1].rawMemory;
+   const uint32_t tag = ((alignedAllocTracker*)block)[-1].tag;
+   const size_t oldOffset = (size_t)((char*)block - (char*)pOldRaw);
+   const size_t allocSize = size + alignment + sizeof(alignedAllocTracker);
+   char* rawMemory = (char*)realloc(pOldRaw, allocSize);
+   if (!rawMemory) { return NULL; }
+   TracyFreeN(pOldRaw, gMemoryTagNames[tag]);
+   TracyAllocN(rawMemory, allocSize, gMemoryTagNames[tag]);
+   ctMemoryTagAccountTracked(tag, (int64_t)size - (int64_t)oldSize, 0);
+   alignedAllocTracker* ptr =
+     (alignedAllocTracker*)((uintptr_t)(rawMemory + alignment +
+                                        sizeof(alignedAllocTracker)) &
+                            ~(alignment - 1));
+   const size_t newOffset = (size_t)((char*)ptr - rawMemory);
+   if (newOffset != oldOffset) {
+      memmove(ptr, rawMemory + oldOffset, oldSize < size ? oldSize : size);
    }
-   return pNew;
+   ptr[-1] = {(void*)rawMemory, size, tag};
+   return (void*)ptr;
 }
 
 void ctAlignedFree(void* block) {
-   ZoneScoped;
    if (!block) { return; }
-   void* pFinal = ((alignedAllocTracker*)block)[-1].rawMemory;
-   TracyFree(pFinal);
+   if (ctPoolOwns(block)) {
+      ctPoolFree(block);
+      return;
+   }
+   ZoneScoped;
+   const alignedAllocTracker tracker = ((alignedAllocTracker*)block)[-1];
+   void* pFinal = tracker.rawMemory;
+   TracyFreeN(pFinal, gMemoryTagNames[tracker.tag]);
    ctAtomicAdd(gAllocCount, -1);
+   ctMemoryTagAccountTracked(tracker.tag, -(int64_t)tracker.originalSize, -1);
    free(pFinal);
 }
 
 CT_API size_t ctGetAliveAllocations() {
-   return (size_t)ctAtomicGet(gAllocCount);
+   /* other threads flush their counts in batches */
+   return (size_t)(ctAtomicGet(gAllocCount) + tPoolCache.aliveDelta);
+}
+
+CT_API void ctMemoryTagPush(ctMemoryTag tag) {
+   ctAssert(tag >= 0 && tag < CT_MEMORY_TAG_COUNT);
+   ctPoolThreadCache& cache = tPoolCache;
+   ctAssert(cache.tagDepth < CT_MEMORY_TAG_STACK_SIZE);
+   if (cache.tagDepth >= CT_MEMORY_TAG_STACK_SIZE) { return; }
+   cache.tagStack[cache.tagDepth++] = (uint8_t)tag;
+}
+
+CT_API void ctMemoryTagPop() {
+   ctPoolThreadCache& cache = tPoolCache;
+   ctAssert(cache.tagDepth > 0);
+   if (cache.tagDepth > 0) { cache.tagDepth--; }
+}
+
+CT_API ctMemoryTag ctMemoryTagGetCurrent() {
+   return (ctMemoryTag)ctMemoryTagGetLocal(tPoolCache);
+}
+
+CT_API const char* ctMemoryTagGetName(ctMemoryTag tag) {
+   if (tag < 0 || tag >= CT_MEMORY_TAG_COUNT) { return "Unknown"; }
+   return gMemoryTagNames[tag];
+}
+
+CT_API ctMemoryTagStats ctMemoryTagGetStats(ctMemoryTag tag) {
+   ctAssert(tag >= 0 && tag < CT_MEMORY_TAG_COUNT);
+   ctMemoryTagCounters& counters = gMemoryTags[tag];
+   ctMemoryTagStats stats;
+   /* other threads flush their deltas in batches */
+   stats.bytes = ctAtomic64Get(counters.bytes) + tPoolCache.tagBytesDelta[tag];
+   stats.count = ctAtomic64Get(counters.count) + tPoolCache.tagCountDelta[tag];
+   stats.highWater = ctAtomic64Get(counters.highWater);
+   if (stats.bytes > stats.highWater) { stats.highWater = stats.bytes; }
+   return stats;
+}
+
+CT_API void ctMemoryTagResetHighWater() {
+   for (int i = 0; i < CT_MEMORY_TAG_COUNT; i++) {
+      ctAtomic64Set(gMemoryTags[i].highWater, ctAtomic64Get(gMemoryTags[i].bytes));
+   }
 }
 
 void* ctMalloc(size_t size) {
-   ZoneScoped;
+   if (size <= CT_POOL_MAX_SIZE) {
+      void* block = ctPoolAlloc(size);
+      if (block) { return block; }
+   }
    return ctAlignedMalloc(size, CT_ALIGNMENT_CACHE);
 }
 
 CT_API void* ctRealloc(void* old, size_t size) {
-   ZoneScoped;
+   if (!old) { return ctMalloc(size); }
+   if (ctPoolOwns(old)) {
+      /* shrinking or growing within the size class keeps the block */
+      const size_t oldSize = ctGetBlockSize(old);
+      if (size <= oldSize) { return old; }
+      void* pNew = ctMalloc(size);
+      memcpy(pNew, old, oldSize);
+      ctFree(old);
+      return pNew;
+   }
    return ctAlignedRealloc(old, size, CT_ALIGNMENT_CACHE);
 }
 
 void ctFree(void* block) {
-   ZoneScoped;
    return ctAlignedFree(block);
 }
 
@@ -95,24 +502,51 @@ CT_API void* ctGroupAlloc(size_t count, ctGroupAllocDesc* groups, size_t* pSizeO
 }
 
 void* operator new(size_t size) {
-   ZoneScoped;
    void* ptr = ctMalloc(size);
    ctAssert(ptr);
    return ptr;
 }
 
 void operator delete(void* ptr) {
-   ZoneScoped;
    ctFree(ptr);
 }
 
 void* operator new[](size_t size) {
-   ZoneScoped;
    void* ptr = ctMalloc(size);
    ctAssert(ptr);
    return ptr;
 }
 void operator delete[](void* ptr) {
-   ZoneScoped;
    ctFree(ptr);
-}
\ No newline at end of file
+}
+
+/* ------------- Virtual Memory ------------- */
+
+CT_API size_t ctVirtualPageSize() {
+   static size_t pageSize = 0;
+   if (!pageSize) { pageSize = ctSystemGetPageSize(); }
+   return pageSize;
+}
+
+CT_API void* ctVirtualReserve(size_t size) {
+   ZoneScoped;
+   return ctSystemReserveMemory(size);
+}
+
+CT_API void ctVirtualRelease(void* address, size_t size) {
+   ZoneScoped;
+   if (!address) { return; }
+   ctSystemReleaseMemory(address, size);
+}
+
+CT_API ctResults ctVirtualCommit(void* address, size_t size) {
+   ZoneScoped;
+   if (ctSystemCommitMemory(address, size) != 0) { return CT_FAILURE_OUT_OF_MEMORY; }
+   return CT_SUCCESS;
+}
+
+CT_API ctResults ctVirtualDecommit(void* address, size_t size) {
+   ZoneScoped;
+   if (ctSystemDecommitMemory(address, size) != 0) { return CT_FAILURE_UNKNOWN; }
+   return CT_SUCCESS;
+}
@@ -17,99 +17,301 @@
 #pragma once
 
 #include "Common.h"
+#include "Allocator.hpp"
+#include <new>
 
-template<class T>
-class ctRingBuffer {
+/* Circular buffer over a power of two capacity, a queue or deque
+ Pushing and popping at either end is O(1), growth doubles the capacity and
+ unwraps the elements to the start of the new storage.
+ Only live elements are constructed (see DynamicArray.hpp for relocation).
+ Storage comes from the Allocator policy (see Allocator.hpp). */
+template<class T, class Allocator = ctHeapAllocator>
+class ctRingBuffer : private Allocator {
 public:
    /* Constructors */
-   ctRingBuffer() = default;
-   ctRingBuffer(const ctRingBuffer<T>& arr);
+   ctRingBuffer();
+   explicit ctRingBuffer(const Allocator& allocator);
+   ctRingBuffer(const ctRingBuffer<T, Allocator>& arr);
+   ~ctRingBuffer();
+   ctRingBuffer<T, Allocator>& operator=(const ctRingBuffer<T, Allocator>& arr);
 
+   /* Access, index 0 is the first element */
+   T& operator[](const size_t index);
+   const T& operator[](const size_t index) const;
    T& First();
    T First() const;
    T& Last();
    T Last() const;
-   /* Reserve */
+   /* Reserve (rounded up to a power of two) */
    ctResults Reserve(const size_t amount);
    /* Count */
    size_t Count() const;
    size_t Capacity() const;
-   /* Append */
+   /* Push to the back */
    ctResults Append(T&& val);
    ctResults Append(const T& val);
+   /* Push to the front */
+   ctResults Prepend(T&& val);
+   ctResults Prepend(const T& val);
+   /* Remove */
    void RemoveFirst();
+   void RemoveLast();
+   /* Move out and remove, false if empty */
+   bool PopFront(T& out);
+   bool PopBack(T& out);
    /* Clear */
    void Clear();
    /* isEmpty */
    bool isEmpty() const;
 
+   Allocator& GetAllocator();
+
 private:
-   ctDynamicArray<T> storage;
-   size_t firstIndex = 0;
+   inline size_t _wrap(const size_t index) const {
+      return index & (_capacity - 1);
+   }
+   ctResults _grow();
+   T* _pData;
+   size_t _capacity;
+   size_t _head;
+   size_t _count;
+};
+
+template<class T, class Allocator>
+struct ctIsTriviallyRelocatable<ctRingBuffer<T, Allocator>> {
+   static const bool value = true;
 };
 
-template<class T>
-inline ctRingBuffer<T>::ctRingBuffer(const ctRingBuffer<T>& arr) {
-   storage = arr.storage;
-   firstIndex = arr.firstIndex;
+template<class T, class Allocator>
+inline ctRingBuffer<T, Allocator>::ctRingBuffer() {
+   _pData = NULL;
+   _capacity = 0;
+   _head = 0;
+   _count = 0;
+}
+
+template<class T, class Allocator>
+inline ctRingBuffer<T, Allocator>::ctRingBuffer(const Allocator& allocator) :
+    Allocator(allocator) {
+   _pData = NULL;
+   _capacity = 0;
+   _head = 0;
+   _count = 0;
+}
+
+template<class T, class Allocator>
+inline ctRingBuffer<T, Allocator>::ctRingBuffer(const ctRingBuffer<T, Allocator>& arr) :
+    ctRingBuffer((const Allocator&)arr) {
+   Reserve(arr._count);
+   for (size_t i = 0; i < arr._count; i++) {
+      Append(arr[i]);
+   }
+}
+
+template<class T, class Allocator>
+inline ctRingBuffer<T, Allocator>::~ctRingBuffer() {
+   Clear();
+   if (_pData) { Allocator::Free(_pData, sizeof(T) * _capacity); }
+   _pData = NULL;
+   _capacity = 0;
+}
+
+template<class T, class Allocator>
+inline ctRingBuffer<T, Allocator>&
+ctRingBuffer<T, Allocator>::operator=(const ctRingBuffer<T, Allocator>& arr) {
+   if (&arr == this) { return *this; }
+   Clear();
+   Reserve(arr._count);
+   for (size_t i = 0; i < arr._count; i++) {
+      Append(arr[i]);
+   }
+   return *this;
+}
+
+template<class T, class Allocator>
+inline T& ctRingBuffer<T, Allocator>::operator[](const size_t index) {
+   ctAssert(index < _count);
+   return _pData[_wrap(_head + index)];
+}
+
+template<class T, class Allocator>
+inline const T& ctRingBuffer<T, Allocator>::operator[](const size_t index) const {
+   ctAssert(index < _count);
+   return _pData[_wrap(_head + index)];
+}
+
+template<class T, class Allocator>
+inline T& ctRingBuffer<T, Allocator>::First() {
+   ctAssert(_count > 0);
+   return _pData[_head];
+}
+
+template<class T, class Allocator>
+inline T ctRingBuffer<T, Allocator>::First() const {
+   ctAssert(_count > 0);
+   return _pData[_head];
+}
+
+template<class T, class Allocator>
+inline T& ctRingBuffer<T, Allocator>::Last() {
+   ctAssert(_count > 0);
+   return _pData[_wrap(_head + _count - 1)];
+}
+
+template<class T, class Allocator>
+inline T ctRingBuffer<T, Allocator>::Last() const {
+   ctAssert(_count > 0);
+   return _pData[_wrap(_head + _count - 1)];
+}
+
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::Reserve(const size_t amount) {
+   if (amount <= _capacity) { return CT_SUCCESS; }
+   size_t capacity = 16;
+   while (capacity < amount) {
+      capacity *= 2;
+   }
+   T* pNewData = (T*)Allocator::Allocate(sizeof(T) * capacity, alignof(T));
+   ctAssert(pNewData);
+   if (!pNewData) { return CT_FAILURE_OUT_OF_MEMORY; }
+   if (_pData) {
+      /* unwrap so the first element lands at the start */
+      const size_t headCount = _capacity - _head < _count ? _capacity - _head : _count;
+      if (ctIsTriviallyRelocatable<T>::value) {
+         memcpy((void*)pNewData, (const void*)&_pData[_head], sizeof(T) * headCount);
+         memcpy((void*)&pNewData[headCount],
+                (const void*)_pData,
+                sizeof(T) * (_count - headCount));
+      } else {
+         for (size_t i = 0; i < _count; i++) {
+            T& old = _pData[_wrap(_head + i)];
+            new (&pNewData[i]) T(ctMove(old));
+            old.~T();
+         }
+      }
+      Allocator::Free(_pData, sizeof(T) * _capacity);
+   }
+   _pData = pNewData;
+   _capacity = capacity;
+   _head = 0;
+   return CT_SUCCESS;
+}
+
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::_grow() {
+   return Reserve(_capacity ? _capacity * 2 : 16);
+}
+
+template<class T, class Allocator>
+inline size_t ctRingBuffer<T, Allocator>::Count() const {
+   return _count;
 }
 
-template<class T>
-inline T& ctRingBuffer<T>::First() {
-   return storage.First();
+template<class T, class Allocator>
+inline size_t ctRingBuffer<T, Allocator>::Capacity() const {
+   return _capacity;
 }
 
-template<class T>
-inline T ctRingBuffer<T>::First() const {
-   return storage.First();
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::Append(T&& val) {
+   if (_count == _capacity) {
+      /* val may live in the storage that is about to move */
+      T moved(ctMove(val));
+      const ctResults result = _grow();
+      if (result != CT_SUCCESS) { return result; }
+      new (&_pData[_wrap(_head + _count)]) T(ctMove(moved));
+   } else {
+      new (&_pData[_wrap(_head + _count)]) T(ctMove(val));
+   }
+   _count++;
+   return CT_SUCCESS;
 }
 
-template<class T>
-inline T& ctRingBuffer<T>::Last() {
-   return storage.Last();
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::Append(const T& val) {
+   if (_count == _capacity) {
+      T copy(val);
+      return Append(ctMove(copy));
+   }
+   new (&_pData[_wrap(_head + _count)]) T(val);
+   _count++;
+   return CT_SUCCESS;
 }
 
-template<class T>
-inline T ctRingBuffer<T>::Last() const {
-   return storage.Last();
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::Prepend(T&& val) {
+   if (_count == _capacity) {
+      T moved(ctMove(val));
+      const ctResults result = _grow();
+      if (result != CT_SUCCESS) { return result; }
+      _head = _wrap(_head - 1);
+      new (&_pData[_head]) T(ctMove(moved));
+   } else {
+      _head = _wrap(_head - 1);
+      new (&_pData[_head]) T(ctMove(val));
+   }
+   _count++;
+   return CT_SUCCESS;
 }
 
-template<class T>
-inline ctResults ctRingBuffer<T>::Reserve(const size_t amount) {
-   return storage.Reserve(amount);
+template<class T, class Allocator>
+inline ctResults ctRingBuffer<T, Allocator>::Prepend(const T& val) {
+   if (_count == _capacity) {
+      T copy(val);
+      return Prepend(ctMove(copy));
+   }
+   _head = _wrap(_head - 1);
+   new (&_pData[_head]) T(val);
+   _count++;
+   return CT_SUCCESS;
 }
 
-template<class T>
-inline size_t ctRingBuffer<T>::Count() const {
-   return storage.Count();
+template<class T, class Allocator>
+inline void ctRingBuffer<T, Allocator>::RemoveFirst() {
+   if (_count == 0) { return; }
+   _pData[_head].~T();
+   _head = _wrap(_head + 1);
+   _count--;
 }
 
-template<class T>
-inline size_t ctRingBuffer<T>::Capacity() const {
-   return storage.Capacity();
+template<class T, class Allocator>
+inline void ctRingBuffer<T, Allocator>::RemoveLast() {
+   if (_count == 0) { return; }
+   _pData[_wrap(_head + _count - 1)].~T();
+   _count--;
 }
 
-template<class T>
-inline ctResults ctRingBuffer<T>::Append(T&& val) {
-   return storage.Append(val);
+template<class T, class Allocator>
+inline bool ctRingBuffer<T, Allocator>::PopFront(T& out) {
+   if (_count == 0) { return false; }
+   out = ctMove(_pData[_head]);
+   RemoveFirst();
+   return true;
 }
 
-template<class T>
-inline ctResults ctRingBuffer<T>::Append(const T& val) {
-   return storage.Append(val);
+template<class T, class Allocator>
+inline bool ctRingBuffer<T, Allocator>::PopBack(T& out) {
+   if (_count == 0) { return false; }
+   out = ctMove(Last());
+   RemoveLast();
+   return true;
 }
 
-template<class T>
-inline void ctRingBuffer<T>::RemoveFirst() {
-   storage.RemoveFirst();
+template<class T, class Allocator>
+inline void ctRingBuffer<T, Allocator>::Clear() {
+   for (size_t i = 0; i < _count; i++) {
+      _pData[_wrap(_head + i)].~T();
+   }
+   _head = 0;
+   _count = 0;
 }
 
-template<class T>
-inline void ctRingBuffer<T>::Clear() {
-   return storage.Clear();
+template<class T, class Allocator>
+inline bool ctRingBuffer<T, Allocator>::isEmpty() const {
+   return _count == 0;
 }
 
-template<class T>
-inline bool ctRingBuffer<T>::isEmpty() const {
-   return storage.isEmpty();
+template<class T, class Allocator>
+inline Allocator& ctRingBuffer<T, Allocator>::GetAllocator() {
+   return *this;
 }
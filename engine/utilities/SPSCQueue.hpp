@@ -0,0 +1,147 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+#include "Allocator.hpp"
+#include <new>
+
+/* Bounded lock free single producer, single consumer queue
+ One thread pushes and one (other) thread pops, each side keeps a stale copy of the
+ other side's index and only reloads it when the queue looks full/empty.
+ Capacity is fixed at creation and must be a power of two, Push() fails when full. */
+template<class T>
+class ctSPSCQueue {
+public:
+   ctSPSCQueue();
+   ctSPSCQueue(const ctSPSCQueue<T>& queue) = delete;
+   ~ctSPSCQueue();
+
+   ctResults Reserve(const size_t capacity);
+
+   /* Producer thread only */
+   bool Push(const T& val);
+   /* Producer thread only */
+   bool Push(T&& val);
+   /* Consumer thread only */
+   bool Pop(T& out);
+
+   /* Approximate when called while the queue is in use */
+   size_t Count();
+   size_t Capacity() const;
+   bool isEmpty();
+
+private:
+   /* written by the producer */
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _tail;
+   int64_t _cachedHead;
+   /* written by the consumer */
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _head;
+   int64_t _cachedTail;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) T* _pData;
+   int64_t _mask;
+};
+
+template<class T>
+inline ctSPSCQueue<T>::ctSPSCQueue() {
+   ctAtomic64Set(_tail, 0);
+   ctAtomic64Set(_head, 0);
+   _cachedHead = 0;
+   _cachedTail = 0;
+   _pData = NULL;
+   _mask = 0;
+}
+
+template<class T>
+inline ctSPSCQueue<T>::~ctSPSCQueue() {
+   if (!_pData) { return; }
+   const int64_t tail = ctAtomic64Get(_tail);
+   for (int64_t i = ctAtomic64Get(_head); i < tail; i++) {
+      _pData[i & _mask].~T();
+   }
+   ctAlignedFree(_pData);
+   _pData = NULL;
+}
+
+template<class T>
+inline ctResults ctSPSCQueue<T>::Reserve(const size_t capacity) {
+   if (_pData) { return CT_FAILURE_NOT_UPDATABLE; }
+   if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      return CT_FAILURE_INVALID_PARAMETER;
+   }
+   _pData = (T*)ctAlignedMalloc(sizeof(T) * capacity, CT_ALIGNMENT_CACHE);
+   if (!_pData) { return CT_FAILURE_OUT_OF_MEMORY; }
+   _mask = (int64_t)capacity - 1;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline bool ctSPSCQueue<T>::Push(const T& val) {
+   ctAssert(_pData);
+   const int64_t tail = ctAtomic64GetAcquire(_tail);
+   if (tail - _cachedHead > _mask) {
+      _cachedHead = ctAtomic64GetAcquire(_head);
+      if (tail - _cachedHead > _mask) { return false; }
+   }
+   new (&_pData[tail & _mask]) T(val);
+   ctAtomic64SetRelease(_tail, tail + 1);
+   return true;
+}
+
+template<class T>
+inline bool ctSPSCQueue<T>::Push(T&& val) {
+   ctAssert(_pData);
+   const int64_t tail = ctAtomic64GetAcquire(_tail);
+   if (tail - _cachedHead > _mask) {
+      _cachedHead = ctAtomic64GetAcquire(_head);
+      if (tail - _cachedHead > _mask) { return false; }
+   }
+   new (&_pData[tail & _mask]) T(ctMove(val));
+   ctAtomic64SetRelease(_tail, tail + 1);
+   return true;
+}
+
+template<class T>
+inline bool ctSPSCQueue<T>::Pop(T& out) {
+   ctAssert(_pData);
+   const int64_t head = ctAtomic64GetAcquire(_head);
+   if (head >= _cachedTail) {
+      _cachedTail = ctAtomic64GetAcquire(_tail);
+      if (head >= _cachedTail) { return false; }
+   }
+   T& slot = _pData[head & _mask];
+   out = ctMove(slot);
+   slot.~T();
+   ctAtomic64SetRelease(_head, head + 1);
+   return true;
+}
+
+template<class T>
+inline size_t ctSPSCQueue<T>::Count() {
+   const int64_t count = ctAtomic64GetAcquire(_tail) - ctAtomic64GetAcquire(_head);
+   return count > 0 ? (size_t)count : 0;
+}
+
+template<class T>
+inline size_t ctSPSCQueue<T>::Capacity() const {
+   return _pData ? (size_t)_mask + 1 : 0;
+}
+
+template<class T>
+inline bool ctSPSCQueue<T>::isEmpty() {
+   return Count() == 0;
+}
@@ -0,0 +1,241 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+
+/* Generational slot map
+ Items live packed together in a dense array, iterating them is a linear scan of
+ Data() up to Count(). Handles point at a slot which knows where its item currently
+ sits, removing swaps the last item into the hole so the array never has gaps.
+ Removed slots bump their generation so stale handles stop resolving (the generation
+ is 8 bits like ctHandleManager, a slot has to be reused 256 times to alias).
+ Item addresses are not stable across Insert/Remove, hold on to handles instead. */
+template<class T, class Allocator = ctHeapAllocator>
+class ctSlotMap {
+public:
+   ctSlotMap();
+   explicit ctSlotMap(const Allocator& allocator);
+
+   ctHandle Insert(const T& val);
+   ctHandle Insert(T&& val);
+   template<class... Args>
+   ctHandle Emplace(Args&&... args);
+   /* Destroys the item, the last item moves into its place */
+   ctResults Remove(const ctHandle handle);
+   /* Destroys every item and invalidates all handles */
+   void Clear();
+   ctResults Reserve(const size_t amount);
+
+   /* NULL if the handle is stale */
+   T* Get(const ctHandle handle);
+   const T* Get(const ctHandle handle) const;
+   T& operator[](const ctHandle handle);
+   const T& operator[](const ctHandle handle) const;
+   bool Exists(const ctHandle handle) const;
+
+   /* Dense access, order changes on Remove */
+   T* Data();
+   const T* Data() const;
+   size_t Count() const;
+   bool isEmpty() const;
+   ctHandle GetHandleAt(const size_t denseIndex) const;
+
+private:
+   struct Slot {
+      uint32_t denseIndex; /* next free slot while unused */
+      uint8_t generation;
+      bool live;
+   };
+   uint32_t _findSlot(const ctHandle handle) const;
+   ctHandle _claimSlot();
+   ctDynamicArray<T, Allocator> _items;
+   /* slot of each dense item */
+   ctDynamicArray<uint32_t, Allocator> _itemSlots;
+   ctDynamicArray<Slot, Allocator> _slots;
+   uint32_t _freeHead;
+};
+
+template<class T, class Allocator>
+inline ctSlotMap<T, Allocator>::ctSlotMap() {
+   _freeHead = 0;
+}
+
+template<class T, class Allocator>
+inline ctSlotMap<T, Allocator>::ctSlotMap(const Allocator& allocator) :
+    _items(allocator), _itemSlots(allocator), _slots(allocator) {
+   _freeHead = 0;
+}
+
+/* 0 if the handle doesn't resolve */
+template<class T, class Allocator>
+inline uint32_t ctSlotMap<T, Allocator>::_findSlot(const ctHandle handle) const {
+   const uint32_t index = ctHandleGetIndex(handle);
+   if (index == 0 || index >= _slots.Count()) { return 0; }
+   const Slot& slot = _slots.Data()[index];
+   if (!slot.live || slot.generation != ctHandleGetGeneration(handle)) { return 0; }
+   return index;
+}
+
+/* Points a slot at the next dense index, the caller appends the item */
+template<class T, class Allocator>
+inline ctHandle ctSlotMap<T, Allocator>::_claimSlot() {
+   uint32_t index = _freeHead;
+   if (index) {
+      _freeHead = _slots[index].denseIndex;
+   } else {
+      const Slot unused = {0, 0, false};
+      /* slot 0 is never handed out so 0 stays an invalid handle */
+      if (_slots.isEmpty()) { _slots.Append(unused); }
+      index = (uint32_t)_slots.Count();
+      ctAssert(index < (1u << 24));
+      _slots.Append(unused);
+   }
+   Slot& slot = _slots[index];
+   slot.denseIndex = (uint32_t)_items.Count();
+   slot.live = true;
+   _itemSlots.Append(index);
+   return ctHandleMake(index, slot.generation);
+}
+
+template<class T, class Allocator>
+inline ctHandle ctSlotMap<T, Allocator>::Insert(const T& val) {
+   if (_items.Count() == _items.Capacity() && _items.Count() &&
+       &val >= _items.Data() && &val < _items.Data() + _items.Count()) {
+      /* val lives in the storage that is about to move */
+      T copy(val);
+      return Insert(ctMove(copy));
+   }
+   const ctHandle handle = _claimSlot();
+   _items.Append(val);
+   return handle;
+}
+
+template<class T, class Allocator>
+inline ctHandle ctSlotMap<T, Allocator>::Insert(T&& val) {
+   const ctHandle handle = _claimSlot();
+   _items.Append(ctMove(val));
+   return handle;
+}
+
+template<class T, class Allocator>
+template<class... Args>
+inline ctHandle ctSlotMap<T, Allocator>::Emplace(Args&&... args) {
+   const ctHandle handle = _claimSlot();
+   _items.EmplaceBack(ctForward<Args>(args)...);
+   return handle;
+}
+
+template<class T, class Allocator>
+inline ctResults ctSlotMap<T, Allocator>::Remove(const ctHandle handle) {
+   const uint32_t index = _findSlot(handle);
+   if (!index) { return CT_FAILURE_DATA_DOES_NOT_EXIST; }
+   Slot& slot = _slots[index];
+   const uint32_t denseIndex = slot.denseIndex;
+   const uint32_t lastIndex = (uint32_t)_items.Count() - 1;
+   if (denseIndex != lastIndex) {
+      _items[denseIndex] = ctMove(_items[lastIndex]);
+      _itemSlots[denseIndex] = _itemSlots[lastIndex];
+      _slots[_itemSlots[denseIndex]].denseIndex = denseIndex;
+   }
+   _items.RemoveLast();
+   _itemSlots.RemoveLast();
+   slot.live = false;
+   slot.generation++;
+   slot.denseIndex = _freeHead;
+   _freeHead = index;
+   return CT_SUCCESS;
+}
+
+template<class T, class Allocator>
+inline void ctSlotMap<T, Allocator>::Clear() {
+   for (size_t i = 0; i < _itemSlots.Count(); i++) {
+      const uint32_t index = _itemSlots[i];
+      Slot& slot = _slots[index];
+      slot.live = false;
+      slot.generation++;
+      slot.denseIndex = _freeHead;
+      _freeHead = index;
+   }
+   _items.Clear();
+   _itemSlots.Clear();
+}
+
+template<class T, class Allocator>
+inline ctResults ctSlotMap<T, Allocator>::Reserve(const size_t amount) {
+   CT_RETURN_FAIL(_items.Reserve(amount));
+   CT_RETURN_FAIL(_itemSlots.Reserve(amount));
+   return _slots.Reserve(amount + 1);
+}
+
+template<class T, class Allocator>
+inline T* ctSlotMap<T, Allocator>::Get(const ctHandle handle) {
+   const uint32_t index = _findSlot(handle);
+   return index ? &_items.Data()[_slots.Data()[index].denseIndex] : NULL;
+}
+
+template<class T, class Allocator>
+inline const T* ctSlotMap<T, Allocator>::Get(const ctHandle handle) const {
+   const uint32_t index = _findSlot(handle);
+   return index ? &_items.Data()[_slots.Data()[index].denseIndex] : NULL;
+}
+
+template<class T, class Allocator>
+inline T& ctSlotMap<T, Allocator>::operator[](const ctHandle handle) {
+   T* pItem = Get(handle);
+   ctAssert(pItem);
+   return *pItem;
+}
+
+template<class T, class Allocator>
+inline const T& ctSlotMap<T, Allocator>::operator[](const ctHandle handle) const {
+   const T* pItem = Get(handle);
+   ctAssert(pItem);
+   return *pItem;
+}
+
+template<class T, class Allocator>
+inline bool ctSlotMap<T, Allocator>::Exists(const ctHandle handle) const {
+   return _findSlot(handle) != 0;
+}
+
+template<class T, class Allocator>
+inline T* ctSlotMap<T, Allocator>::Data() {
+   return _items.Data();
+}
+
+template<class T, class Allocator>
+inline const T* ctSlotMap<T, Allocator>::Data() const {
+   return _items.Data();
+}
+
+template<class T, class Allocator>
+inline size_t ctSlotMap<T, Allocator>::Count() const {
+   return _items.Count();
+}
+
+template<class T, class Allocator>
+inline bool ctSlotMap<T, Allocator>::isEmpty() const {
+   return _items.Count() == 0;
+}
+
+template<class T, class Allocator>
+inline ctHandle ctSlotMap<T, Allocator>::GetHandleAt(const size_t denseIndex) const {
+   ctAssert(denseIndex < _itemSlots.Count());
+   const uint32_t index = _itemSlots.Data()[denseIndex];
+   return ctHandleMake(index, _slots.Data()[index].generation);
+}
@@ -96,4 +96,7 @@ private:
    void _nullTerminate();
 
    ctDynamicArray<char> _data;
-};
\ No newline at end of file
+};
+
+/* Only owns the character array, growing arrays of strings can memcpy them */
+CT_TRIVIALLY_RELOCATABLE(ctStringUtf8);
\ No newline at end of file
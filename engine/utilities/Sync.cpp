@@ -14,6 +14,7 @@
    limitations under the License.
 */
 
+#include "Common.h"
 #include "Sync.hpp"
 
 ctMutex ctMutexCreate() {
@@ -48,6 +49,10 @@ CT_API void ctConditionalWait(ctConditional cond, ctMutex lock) {
    SDL_CondWait(cond, lock);
 }
 
+CT_API bool ctConditionalWaitTimeout(ctConditional cond, ctMutex lock, uint32_t ms) {
+   return SDL_CondWaitTimeout(cond, lock, ms) != SDL_MUTEX_TIMEDOUT;
+}
+
 CT_API void ctConditionalSignalOne(ctConditional cond) {
    SDL_CondSignal(cond);
 }
@@ -18,6 +18,10 @@
 
 #include "Common.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 typedef SDL_mutex* ctMutex;
 CT_API ctMutex ctMutexCreate();
 CT_API void ctMutexDestroy(ctMutex mutex);
@@ -35,6 +39,9 @@ inline void ctSpinLockInit(ctSpinLock& val) {
 inline void ctSpinLockEnterCritical(ctSpinLock& val) {
    SDL_AtomicLock(&val);
 };
+inline bool ctSpinLockTryEnterCritical(ctSpinLock& val) {
+   return SDL_AtomicTryLock(&val) == SDL_TRUE;
+};
 inline void ctSpinLockExitCritical(ctSpinLock& val) {
    SDL_AtomicUnlock(&val);
 };
@@ -56,8 +63,9 @@ private:
    _ctSpinLockAutoLifetimeObject _NAME = _ctSpinLockAutoLifetimeObject(_LOCKVAR);
 
 typedef SDL_atomic_t ctAtomic;
-inline void ctAtomicAdd(ctAtomic& atomic, int val) {
-   SDL_AtomicAdd(&atomic, val);
+/* returns the value before the add */
+inline int ctAtomicAdd(ctAtomic& atomic, int val) {
+   return SDL_AtomicAdd(&atomic, val);
 }
 inline int ctAtomicGet(ctAtomic& atomic) {
    return SDL_AtomicGet(&atomic);
@@ -65,11 +73,90 @@ inline int ctAtomicGet(ctAtomic& atomic) {
 inline int ctAtomicSet(ctAtomic& atomic, int val) {
    return SDL_AtomicSet(&atomic, val);
 }
+inline bool ctAtomicCompareExchange(ctAtomic& atomic, int expected, int desired) {
+   return SDL_AtomicCAS(&atomic, expected, desired) == SDL_TRUE;
+}
+
+/* SDL only exposes 32 bit atomics, 64 bit counters go to the compiler directly */
+/* all operations are sequentially consistent unless named Acquire/Release */
+struct ctAtomic64 {
+   volatile int64_t value;
+};
+#if defined(_MSC_VER)
+inline int64_t ctAtomic64Get(ctAtomic64& atomic) {
+   return _InterlockedOr64(&atomic.value, 0);
+}
+inline int64_t ctAtomic64Set(ctAtomic64& atomic, int64_t val) {
+   return _InterlockedExchange64(&atomic.value, val);
+}
+/* returns the value before the add */
+inline int64_t ctAtomic64Add(ctAtomic64& atomic, int64_t val) {
+   return _InterlockedExchangeAdd64(&atomic.value, val);
+}
+inline bool
+ctAtomic64CompareExchange(ctAtomic64& atomic, int64_t expected, int64_t desired) {
+   return _InterlockedCompareExchange64(&atomic.value, desired, expected) == expected;
+}
+/* x64 loads and stores are already ordered, only keep the compiler from moving them */
+inline int64_t ctAtomic64GetAcquire(ctAtomic64& atomic) {
+   const int64_t val = atomic.value;
+   _ReadWriteBarrier();
+   return val;
+}
+inline void ctAtomic64SetRelease(ctAtomic64& atomic, int64_t val) {
+   _ReadWriteBarrier();
+   atomic.value = val;
+}
+/* full two-way barrier */
+inline void ctAtomicFence() {
+   _mm_mfence();
+}
+/* hint to the cpu that we are spinning */
+inline void ctAtomicSpinPause() {
+   _mm_pause();
+}
+#else
+inline int64_t ctAtomic64Get(ctAtomic64& atomic) {
+   return __atomic_load_n(&atomic.value, __ATOMIC_SEQ_CST);
+}
+inline int64_t ctAtomic64Set(ctAtomic64& atomic, int64_t val) {
+   return __atomic_exchange_n(&atomic.value, val, __ATOMIC_SEQ_CST);
+}
+/* returns the value before the add */
+inline int64_t ctAtomic64Add(ctAtomic64& atomic, int64_t val) {
+   return __atomic_fetch_add(&atomic.value, val, __ATOMIC_SEQ_CST);
+}
+inline bool
+ctAtomic64CompareExchange(ctAtomic64& atomic, int64_t expected, int64_t desired) {
+   return __atomic_compare_exchange_n(
+     &atomic.value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+inline int64_t ctAtomic64GetAcquire(ctAtomic64& atomic) {
+   return __atomic_load_n(&atomic.value, __ATOMIC_ACQUIRE);
+}
+inline void ctAtomic64SetRelease(ctAtomic64& atomic, int64_t val) {
+   __atomic_store_n(&atomic.value, val, __ATOMIC_RELEASE);
+}
+/* full two-way barrier */
+inline void ctAtomicFence() {
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+/* hint to the cpu that we are spinning */
+inline void ctAtomicSpinPause() {
+#if defined(__i386__) || defined(__x86_64__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__)
+   __asm__ __volatile__("yield");
+#endif
+}
+#endif
 
 typedef SDL_cond* ctConditional;
 CT_API ctConditional ctConditionalCreate();
 CT_API void ctConditionalDestroy(ctConditional cond);
 CT_API void ctConditionalWait(ctConditional cond, ctMutex lock);
+/* Returns false if ms passed without a signal */
+CT_API bool ctConditionalWaitTimeout(ctConditional cond, ctMutex lock, uint32_t ms);
 CT_API void ctConditionalSignalOne(ctConditional cond);
 CT_API void ctConditionalSignalAll(ctConditional cond);
 
@@ -0,0 +1,228 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+#include <new>
+
+/* Address space reserved by default, nothing is committed until the array grows */
+#define CT_VIRTUAL_ARRAY_DEFAULT_RESERVE ((size_t)64 * 1024 * 1024 * 1024)
+
+/*
+ * Array that reserves its whole address range once and commits pages as it grows
+ * Growing never moves or copies the elements so pointers to them stay valid and
+ * there is no second copy while it grows, meant for very large build time tables.
+ * Only address space is used up front, the range is reserved on first growth.
+ * Appending past the reserved range fails with CT_FAILURE_OUT_OF_MEMORY.
+ */
+template<class T>
+class ctVirtualArray {
+public:
+   ctVirtualArray(size_t reserveBytes = CT_VIRTUAL_ARRAY_DEFAULT_RESERVE);
+   ctVirtualArray(const ctVirtualArray<T>& arr) = delete;
+   ~ctVirtualArray();
+
+   T& operator[](const size_t index);
+   const T& operator[](const size_t index) const;
+   T& First();
+   T& Last();
+   T* Data() const;
+   size_t Count() const;
+   /* Elements that fit in the committed pages */
+   size_t Capacity() const;
+   /* Elements that fit in the reserved range */
+   size_t MaxCount() const;
+   bool isEmpty() const;
+
+   /* Commits enough pages for amount elements */
+   ctResults Reserve(const size_t amount);
+   ctResults Resize(const size_t amount);
+   ctResults Append(const T& val);
+   ctResults Append(const T& val, const size_t amount);
+   ctResults Append(const T* pArray, const size_t length);
+   template<class Allocator>
+   ctResults Append(const ctDynamicArray<T, Allocator>& arr);
+   void RemoveLast();
+   void Clear();
+   /* Decommits the pages past the last element */
+   void Shrink();
+
+private:
+   T* _pData;
+   size_t _count;
+   size_t _committedBytes;
+   size_t _reservedBytes;
+};
+
+template<class T>
+inline ctVirtualArray<T>::ctVirtualArray(size_t reserveBytes) {
+   const size_t pageSize = ctVirtualPageSize();
+   _pData = NULL;
+   _count = 0;
+   _committedBytes = 0;
+   _reservedBytes = (reserveBytes + pageSize - 1) / pageSize * pageSize;
+}
+
+template<class T>
+inline ctVirtualArray<T>::~ctVirtualArray() {
+   Clear();
+   ctVirtualRelease(_pData, _reservedBytes);
+   _pData = NULL;
+}
+
+template<class T>
+inline T& ctVirtualArray<T>::operator[](const size_t index) {
+   ctAssert(index < _count);
+   return _pData[index];
+}
+
+template<class T>
+inline const T& ctVirtualArray<T>::operator[](const size_t index) const {
+   ctAssert(index < _count);
+   return _pData[index];
+}
+
+template<class T>
+inline T& ctVirtualArray<T>::First() {
+   ctAssert(_count > 0);
+   return _pData[0];
+}
+
+template<class T>
+inline T& ctVirtualArray<T>::Last() {
+   ctAssert(_count > 0);
+   return _pData[_count - 1];
+}
+
+template<class T>
+inline T* ctVirtualArray<T>::Data() const {
+   return _pData;
+}
+
+template<class T>
+inline size_t ctVirtualArray<T>::Count() const {
+   return _count;
+}
+
+template<class T>
+inline size_t ctVirtualArray<T>::Capacity() const {
+   return _committedBytes / sizeof(T);
+}
+
+template<class T>
+inline size_t ctVirtualArray<T>::MaxCount() const {
+   return _reservedBytes / sizeof(T);
+}
+
+template<class T>
+inline bool ctVirtualArray<T>::isEmpty() const {
+   return _count == 0;
+}
+
+template<class T>
+inline ctResults ctVirtualArray<T>::Reserve(const size_t amount) {
+   if (amount <= Capacity()) { return CT_SUCCESS; }
+   if (amount > MaxCount()) { return CT_FAILURE_OUT_OF_MEMORY; }
+   if (!_pData) {
+      _pData = (T*)ctVirtualReserve(_reservedBytes);
+      if (!_pData) { return CT_FAILURE_OUT_OF_MEMORY; }
+   }
+   /* commit ahead by a quarter of what is in use to keep the calls rare */
+   const size_t pageSize = ctVirtualPageSize();
+   size_t targetBytes = amount * sizeof(T);
+   const size_t aheadBytes = _committedBytes + _committedBytes / 4;
+   if (targetBytes < aheadBytes) { targetBytes = aheadBytes; }
+   targetBytes = (targetBytes + pageSize - 1) / pageSize * pageSize;
+   if (targetBytes > _reservedBytes) { targetBytes = _reservedBytes; }
+   CT_RETURN_FAIL(ctVirtualCommit((uint8_t*)_pData + _committedBytes,
+                                  targetBytes - _committedBytes));
+   _committedBytes = targetBytes;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline ctResults ctVirtualArray<T>::Resize(const size_t amount) {
+   CT_RETURN_FAIL(Reserve(amount));
+   for (size_t i = _count; i < amount; i++) {
+      new (&_pData[i]) T;
+   }
+   for (size_t i = amount; i < _count; i++) {
+      _pData[i].~T();
+   }
+   _count = amount;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline ctResults ctVirtualArray<T>::Append(const T& val) {
+   if (_count >= Capacity()) { CT_RETURN_FAIL(Reserve(_count + 1)); }
+   new (&_pData[_count]) T(val);
+   _count++;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline ctResults ctVirtualArray<T>::Append(const T& val, const size_t amount) {
+   CT_RETURN_FAIL(Reserve(_count + amount));
+   for (size_t i = 0; i < amount; i++) {
+      new (&_pData[_count + i]) T(val);
+   }
+   _count += amount;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline ctResults ctVirtualArray<T>::Append(const T* pArray, const size_t length) {
+   CT_RETURN_FAIL(Reserve(_count + length));
+   for (size_t i = 0; i < length; i++) {
+      new (&_pData[_count + i]) T(pArray[i]);
+   }
+   _count += length;
+   return CT_SUCCESS;
+}
+
+template<class T>
+template<class Allocator>
+inline ctResults ctVirtualArray<T>::Append(const ctDynamicArray<T, Allocator>& arr) {
+   return Append(arr.Data(), arr.Count());
+}
+
+template<class T>
+inline void ctVirtualArray<T>::RemoveLast() {
+   if (!_count) { return; }
+   _count--;
+   _pData[_count].~T();
+}
+
+template<class T>
+inline void ctVirtualArray<T>::Clear() {
+   for (size_t i = 0; i < _count; i++) {
+      _pData[i].~T();
+   }
+   _count = 0;
+}
+
+template<class T>
+inline void ctVirtualArray<T>::Shrink() {
+   const size_t pageSize = ctVirtualPageSize();
+   const size_t keepBytes = (_count * sizeof(T) + pageSize - 1) / pageSize * pageSize;
+   if (keepBytes >= _committedBytes) { return; }
+   if (ctVirtualDecommit((uint8_t*)_pData + keepBytes, _committedBytes - keepBytes) ==
+       CT_SUCCESS) {
+      _committedBytes = keepBytes;
+   }
+}
@@ -0,0 +1,140 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Common.h"
+
+/* See: "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+ Bounded Chase-Lev deque, the owning thread pushes and pops at the bottom (LIFO),
+ any other thread can steal from the top (FIFO).
+ Capacity is fixed at creation and must be a power of two, Push() fails when full.
+ T must be trivially copyable, a thief may read a slot that is being recycled but
+ the following compare exchange on top will fail and the copy is discarded. */
+template<class T>
+class ctWorkStealingDeque {
+public:
+   ctWorkStealingDeque();
+   ctWorkStealingDeque(const ctWorkStealingDeque<T>& deque) = delete;
+   ~ctWorkStealingDeque();
+
+   ctResults Reserve(const size_t capacity);
+
+   /* Owner thread only */
+   bool Push(const T& val);
+   /* Owner thread only */
+   bool Pop(T& out);
+   /* Any thread */
+   bool Steal(T& out);
+
+   /* Approximate when called outside of the owner thread */
+   size_t Count();
+   size_t Capacity() const;
+   bool isEmpty();
+
+private:
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _top;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) ctAtomic64 _bottom;
+   CT_ALIGN(CT_ALIGNMENT_CACHE) T* _pData;
+   int64_t _mask;
+};
+
+template<class T>
+inline ctWorkStealingDeque<T>::ctWorkStealingDeque() {
+   ctAtomic64Set(_top, 0);
+   ctAtomic64Set(_bottom, 0);
+   _pData = NULL;
+   _mask = 0;
+}
+
+template<class T>
+inline ctWorkStealingDeque<T>::~ctWorkStealingDeque() {
+   if (_pData) { ctAlignedFree(_pData); }
+   _pData = NULL;
+}
+
+template<class T>
+inline ctResults ctWorkStealingDeque<T>::Reserve(const size_t capacity) {
+   if (_pData) { return CT_FAILURE_NOT_UPDATABLE; }
+   if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      return CT_FAILURE_INVALID_PARAMETER;
+   }
+   _pData = (T*)ctAlignedMalloc(sizeof(T) * capacity, CT_ALIGNMENT_CACHE);
+   if (!_pData) { return CT_FAILURE_OUT_OF_MEMORY; }
+   _mask = (int64_t)capacity - 1;
+   return CT_SUCCESS;
+}
+
+template<class T>
+inline bool ctWorkStealingDeque<T>::Push(const T& val) {
+   ctAssert(_pData);
+   const int64_t bottom = ctAtomic64Get(_bottom);
+   const int64_t top = ctAtomic64Get(_top);
+   if (bottom - top > _mask) { return false; }
+   _pData[bottom & _mask] = val;
+   ctAtomic64Set(_bottom, bottom + 1);
+   return true;
+}
+
+template<class T>
+inline bool ctWorkStealingDeque<T>::Pop(T& out) {
+   ctAssert(_pData);
+   const int64_t bottom = ctAtomic64Get(_bottom) - 1;
+   ctAtomic64Set(_bottom, bottom);
+   ctAtomicFence();
+   int64_t top = ctAtomic64Get(_top);
+   if (top > bottom) {
+      /* already empty */
+      ctAtomic64Set(_bottom, bottom + 1);
+      return false;
+   }
+   out = _pData[bottom & _mask];
+   if (top == bottom) {
+      /* last item, race any thieves for it */
+      const bool won = ctAtomic64CompareExchange(_top, top, top + 1);
+      ctAtomic64Set(_bottom, bottom + 1);
+      return won;
+   }
+   return true;
+}
+
+template<class T>
+inline bool ctWorkStealingDeque<T>::Steal(T& out) {
+   const int64_t top = ctAtomic64Get(_top);
+   ctAtomicFence();
+   const int64_t bottom = ctAtomic64Get(_bottom);
+   if (top >= bottom) { return false; }
+   T result = _pData[top & _mask];
+   if (!ctAtomic64CompareExchange(_top, top, top + 1)) { return false; }
+   out = result;
+   return true;
+}
+
+template<class T>
+inline size_t ctWorkStealingDeque<T>::Count() {
+   const int64_t count = ctAtomic64Get(_bottom) - ctAtomic64Get(_top);
+   return count > 0 ? (size_t)count : 0;
+}
+
+template<class T>
+inline size_t ctWorkStealingDeque<T>::Capacity() const {
+   return _pData ? (size_t)_mask + 1 : 0;
+}
+
+template<class T>
+inline bool ctWorkStealingDeque<T>::isEmpty() {
+   return Count() == 0;
+}
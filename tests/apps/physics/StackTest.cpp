@@ -62,9 +62,20 @@ void StackTest::OnTestStartup() {
 }
 
 void StackTest::OnTick(float deltaTime) {
+   averageFrameTime = ctLerp(averageFrameTime, deltaTime, 0.05f);
 }
 
 void StackTest::UIStatus() {
+   ImGui::Text("Frame: %.2fms", averageFrameTime * 1000.0f);
+   /* physics steps run on the job system, this is where its scaling shows */
+   ctJobSystem* pJobSystem = ctGetJobSystem();
+   for (size_t i = 0; i <= pJobSystem->GetThreadCount(); i++) {
+      const ctJobWorkerStats stats = pJobSystem->GetWorkerStats(i);
+      char label[32];
+      snprintf(label, 32, i ? "Worker %d" : "Host", (int)i);
+      ImGui::ProgressBar((float)stats.utilization, ImVec2(-FLT_MIN, 0.0f), label);
+   }
+   if (ImGui::Button("Reset Job Stats")) { pJobSystem->ResetStats(); }
 }
 
 void StackTest::OnTestShutdown() {
@@ -19,6 +19,7 @@
 #include "utilities/Common.h"
 
 #include "PhysicsTest.hpp"
+#include "core/JobSystem.hpp"
 
 class StackTest : public PhysicsTestBase {
 public:
@@ -31,5 +32,6 @@ public:
 
 private:
    int bodyCount = 50;
+   float averageFrameTime = 0.0f;
    ctDynamicArray<ctPhysicsBody> bodies;
 };
\ No newline at end of file
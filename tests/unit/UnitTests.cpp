@@ -29,7 +29,7 @@
    CT_TEST_ENTRY(bloom_filter_test)                                                      \
    CT_TEST_ENTRY(spacial_query_test) CT_TEST_ENTRY(hash_table_test)                      \
      CT_TEST_ENTRY(json_test) CT_TEST_ENTRY(math_3d_test)                                \
-       CT_TEST_ENTRY(handled_list_test)
+       CT_TEST_ENTRY(slot_map_test)
 
 /* -------------------------------------------------------- */
 #undef CT_TEST_ENTRY
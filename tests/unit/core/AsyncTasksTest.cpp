@@ -0,0 +1,219 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "utilities/Common.h"
+#include "core/AsyncTasks.hpp"
+
+#define TEST_NO_MAIN
+#include "acutest/acutest.h"
+
+struct AsyncTestContext {
+   ctAtomic open;
+   ctAtomic order;
+   ctAtomic running;
+   ctAtomic peakRunning;
+   ctAtomic failures;
+   int32_t finishedPriorities[8];
+};
+
+struct AsyncTestTask {
+   AsyncTestContext* pCtx;
+   int32_t priority;
+};
+
+static ctResults async_test_gate(void* data) {
+   AsyncTestContext* pCtx = (AsyncTestContext*)data;
+   while (!ctAtomicGet(pCtx->open)) {
+      ctWait(1);
+   }
+   return CT_SUCCESS;
+}
+
+static ctResults async_test_ordered(void* data) {
+   AsyncTestTask* pTask = (AsyncTestTask*)data;
+   const int32_t order = ctAtomicAdd(pTask->pCtx->order, 1);
+   if (order < 8) { pTask->pCtx->finishedPriorities[order] = pTask->priority; }
+   return CT_SUCCESS;
+}
+
+static ctResults async_test_capped(void* data) {
+   AsyncTestContext* pCtx = (AsyncTestContext*)data;
+   const int32_t running = ctAtomicAdd(pCtx->running, 1) + 1;
+   int32_t peak = ctAtomicGet(pCtx->peakRunning);
+   while (running > peak && !ctAtomicCompareExchange(pCtx->peakRunning, peak, running)) {
+      peak = ctAtomicGet(pCtx->peakRunning);
+   }
+   ctWait(2);
+   ctAtomicAdd(pCtx->running, -1);
+   return CT_SUCCESS;
+}
+
+void async_priority_test(void) {
+   ZoneScoped;
+   ctAsyncManager async = ctAsyncManager(false);
+   TEST_ASSERT(async.SpawnThreads(1) == CT_SUCCESS);
+   AsyncTestContext ctx = AsyncTestContext();
+   ctAtomicSet(ctx.open, 0);
+   ctAtomicSet(ctx.order, 0);
+
+   /* hold the only thread so everything below queues up */
+   ctAsyncTaskHandle gate = async.CreateTask("Gate", async_test_gate, &ctx, 100);
+   const int32_t priorities[6] = {1, 5, 3, 5, -2, 3};
+   AsyncTestTask tasks[6];
+   for (int32_t i = 0; i < 6; i++) {
+      tasks[i].pCtx = &ctx;
+      tasks[i].priority = priorities[i];
+      async.CreateTask("Ordered", async_test_ordered, &tasks[i], priorities[i]);
+   }
+   TEST_CHECK(!async.isEmpty());
+   ctAtomicSet(ctx.open, 1);
+   async.WaitForAllToExit();
+   TEST_CHECK(async.isEmpty());
+   ctResults result = CT_FAILURE_UNKNOWN;
+   TEST_CHECK(async.isFinished(gate, &result));
+   TEST_CHECK(result == CT_SUCCESS);
+   async.ReleaseTask(gate);
+
+   const int32_t expected[6] = {5, 5, 3, 3, 1, -2};
+   for (int32_t i = 0; i < 6; i++) {
+      TEST_CHECK(ctx.finishedPriorities[i] == expected[i]);
+   }
+   async.JoinThreads();
+}
+
+void async_concurrency_test(void) {
+   ZoneScoped;
+   ctAsyncManager async = ctAsyncManager(false);
+   TEST_ASSERT(async.SpawnThreads(4) == CT_SUCCESS);
+   async.SetPriorityConcurrency(0, 1);
+   AsyncTestContext ctx = AsyncTestContext();
+   ctAtomicSet(ctx.running, 0);
+   ctAtomicSet(ctx.peakRunning, 0);
+   for (int32_t i = 0; i < 16; i++) {
+      async.CreateTask("Capped", async_test_capped, &ctx, 0);
+   }
+   async.WaitForAllToExit();
+   TEST_CHECK(ctAtomicGet(ctx.peakRunning) == 1);
+
+   /* lifting the cap lets the pool run them side by side again */
+   async.SetPriorityConcurrency(0, 0);
+   ctAtomicSet(ctx.peakRunning, 0);
+   for (int32_t i = 0; i < 16; i++) {
+      async.CreateTask("Uncapped", async_test_capped, &ctx, 0);
+   }
+   async.WaitForAllToExit();
+   TEST_CHECK(ctAtomicGet(ctx.peakRunning) > 1);
+   async.JoinThreads();
+}
+
+static ctResults async_test_step(void* data) {
+   AsyncTestTask* pTask = (AsyncTestTask*)data;
+   const int32_t order = ctAtomicAdd(pTask->pCtx->order, 1);
+   if (order < 8) { pTask->pCtx->finishedPriorities[order] = pTask->priority; }
+   return pTask->priority >= 0 ? CT_SUCCESS : CT_FAILURE_UNKNOWN;
+}
+
+static void
+async_test_on_complete(ctAsyncTaskHandle handle, ctResults results, void* data) {
+   AsyncTestContext* pCtx = (AsyncTestContext*)data;
+   ctAtomicAdd(pCtx->running, 1);
+   if (results != CT_SUCCESS) { ctAtomicAdd(pCtx->failures, 1); }
+}
+
+void async_completion_test(void) {
+   ZoneScoped;
+   ctAsyncManager async = ctAsyncManager(false);
+   TEST_ASSERT(async.SpawnThreads(2) == CT_SUCCESS);
+   AsyncTestContext ctx = AsyncTestContext();
+   ctAtomicSet(ctx.open, 0);
+   ctAtomicSet(ctx.order, 0);
+   ctAtomicSet(ctx.running, 0);
+   ctAtomicSet(ctx.failures, 0);
+
+   /* wait times out while the gate is closed */
+   ctAsyncTaskHandle gate = async.CreateTask("Gate", async_test_gate, &ctx, 0);
+   TEST_CHECK(async.Wait(gate, 5) == CT_FAILURE_NOT_FINISHED);
+   async.OnComplete(gate, async_test_on_complete, &ctx);
+
+   /* chain of three that should run in order after the gate */
+   AsyncTestTask steps[3];
+   ctAsyncTaskHandle previous = gate;
+   ctAsyncTaskHandle chain[3];
+   for (int32_t i = 0; i < 3; i++) {
+      steps[i].pCtx = &ctx;
+      steps[i].priority = i + 1;
+      chain[i] = async.Then(previous, "Step", async_test_step, &steps[i], 0);
+      previous = chain[i];
+   }
+   TEST_CHECK(!async.isFinished(chain[2]));
+   ctAtomicSet(ctx.open, 1);
+   ctResults result = CT_FAILURE_UNKNOWN;
+   TEST_CHECK(async.Wait(gate, -1, &result) == CT_SUCCESS);
+   TEST_CHECK(result == CT_SUCCESS);
+   TEST_CHECK(async.Wait(chain[2], -1, &result) == CT_SUCCESS);
+   TEST_CHECK(result == CT_SUCCESS);
+   TEST_CHECK(ctAtomicGet(ctx.order) == 3);
+   for (int32_t i = 0; i < 3; i++) {
+      TEST_CHECK(ctx.finishedPriorities[i] == i + 1);
+   }
+
+   /* a failing step skips the rest of its chain */
+   AsyncTestTask failing = {&ctx, -1};
+   AsyncTestTask skipped = {&ctx, 10};
+   ctAsyncTaskHandle failed = async.CreateTask("Fail", async_test_step, &failing, 0);
+   ctAsyncTaskHandle after = async.Then(failed, "Skipped", async_test_step, &skipped, 0);
+   ctAsyncTaskHandle afterAfter =
+     async.Then(after, "Skipped", async_test_step, &skipped, 0);
+   async.OnComplete(afterAfter, async_test_on_complete, &ctx);
+   async.WaitForAllToExit();
+   TEST_CHECK(async.isFinished(after, &result));
+   TEST_CHECK(result == CT_FAILURE_DEPENDENCY_NOT_MET);
+   TEST_CHECK(async.isFinished(afterAfter, &result));
+   TEST_CHECK(result == CT_FAILURE_DEPENDENCY_NOT_MET);
+   TEST_CHECK(ctAtomicGet(ctx.order) == 4);
+
+   /* callbacks only run when dispatched, including late registrations */
+   async.OnComplete(chain[0], async_test_on_complete, &ctx);
+   TEST_CHECK(ctAtomicGet(ctx.running) == 0);
+   async.DispatchCompletions();
+   TEST_CHECK(ctAtomicGet(ctx.running) == 3);
+   TEST_CHECK(ctAtomicGet(ctx.failures) == 1);
+   async.DispatchCompletions();
+   TEST_CHECK(ctAtomicGet(ctx.running) == 3);
+   async.JoinThreads();
+}
+
+void async_join_test(void) {
+   ZoneScoped;
+   ctAsyncManager async = ctAsyncManager(false);
+   AsyncTestContext ctx = AsyncTestContext();
+   ctAtomicSet(ctx.order, 0);
+
+   /* no threads to run them, joining fails what is left instead of leaking it */
+   AsyncTestTask task = {&ctx, 1};
+   ctAsyncTaskHandle queued = async.CreateTask("Queued", async_test_step, &task, 0);
+   ctAsyncTaskHandle chained = async.Then(queued, "Chained", async_test_step, &task, 0);
+   TEST_CHECK(!async.isEmpty());
+   async.JoinThreads();
+   TEST_CHECK(async.isEmpty());
+   async.WaitForAllToExit();
+   ctResults result = CT_SUCCESS;
+   TEST_CHECK(async.Wait(queued, -1, &result) == CT_SUCCESS);
+   TEST_CHECK(result == CT_FAILURE_SKIPPED);
+   TEST_CHECK(async.isFinished(chained, &result));
+   TEST_CHECK(result == CT_FAILURE_DEPENDENCY_NOT_MET);
+   TEST_CHECK(ctAtomicGet(ctx.order) == 0);
+}
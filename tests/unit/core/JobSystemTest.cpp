@@ -0,0 +1,542 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "utilities/Common.h"
+#include "core/JobSystem.hpp"
+
+#define TEST_NO_MAIN
+#include "acutest/acutest.h"
+
+struct JobTestContext {
+   ctJobSystem* pJobSystem;
+   ctAtomic counter;
+   int32_t fanout;
+   int32_t spin;
+};
+
+static void job_test_leaf(void* data) {
+   JobTestContext* pCtx = (JobTestContext*)data;
+   volatile float accum = 0.0f;
+   for (int32_t i = 0; i < pCtx->spin; i++) {
+      accum += sqrtf((float)i);
+   }
+   ctAtomicAdd(pCtx->counter, 1);
+}
+
+/* pushes from inside a job land on the local deque */
+static void job_test_spawner(void* data) {
+   JobTestContext* pCtx = (JobTestContext*)data;
+   void (*fpFunctions[64])(void*);
+   void* pData[64];
+   for (int32_t i = 0; i < 64; i++) {
+      fpFunctions[i] = job_test_leaf;
+      pData[i] = pCtx;
+   }
+   for (int32_t i = 0; i < pCtx->fanout; i++) {
+      pCtx->pJobSystem->PushJobs(64, fpFunctions, pData);
+   }
+   ctAtomicAdd(pCtx->counter, 1);
+}
+
+static int32_t job_test_run(ctJobSystem& jobSystem,
+                            JobTestContext& ctx,
+                            int32_t spawners,
+                            int32_t rounds) {
+   ctAtomicSet(ctx.counter, 0);
+   for (int32_t r = 0; r < rounds; r++) {
+      for (int32_t i = 0; i < spawners; i++) {
+         jobSystem.PushJob(job_test_spawner, &ctx);
+      }
+      jobSystem.WaitBarrier();
+   }
+   return ctAtomicGet(ctx.counter);
+}
+
+void job_system_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(4) == CT_SUCCESS);
+   TEST_CHECK(jobSystem.GetThreadCount() == 4);
+   JobTestContext ctx;
+   ctx.pJobSystem = &jobSystem;
+   ctx.fanout = 4;
+   ctx.spin = 16;
+   const int32_t spawners = 32;
+   const int32_t rounds = 8;
+   const int32_t expected = rounds * spawners * (1 + ctx.fanout * 64);
+   TEST_CHECK(job_test_run(jobSystem, ctx, spawners, rounds) == expected);
+   TEST_CHECK(!jobSystem.isMoreWorkAvailible());
+
+   /* batches bigger than the stack would hold go out in chunks */
+   const size_t batchSize = 100000;
+   void (**pfpFunctions)(void*) =
+     (void (**)(void*))ctMalloc(sizeof(void (*)(void*)) * batchSize);
+   void** ppData = (void**)ctMalloc(sizeof(void*) * batchSize);
+   for (size_t i = 0; i < batchSize; i++) {
+      pfpFunctions[i] = job_test_leaf;
+      ppData[i] = &ctx;
+   }
+   ctAtomicSet(ctx.counter, 0);
+   const ctJobSystemDependency batchDone = jobSystem.DeclareDependency("Big Batch");
+   TEST_CHECK(jobSystem.PushJobs(batchSize, pfpFunctions, ppData, 0, NULL, batchDone) ==
+              CT_SUCCESS);
+   jobSystem.WaitForDependency(batchDone);
+   TEST_CHECK(ctAtomicGet(ctx.counter) == (int32_t)batchSize);
+   ctFree(ppData);
+   ctFree(pfpFunctions);
+   jobSystem.JoinWorkers();
+}
+
+void job_system_scaling_test(void) {
+   ZoneScoped;
+   const int32_t maxThreads = SDL_GetCPUCount();
+   double baseline = 0.0;
+   for (int32_t threads = 1; threads <= maxThreads; threads++) {
+      ctJobSystem jobSystem = ctJobSystem(0, false);
+      TEST_ASSERT(jobSystem.SpawnWorkers(threads) == CT_SUCCESS);
+      JobTestContext ctx;
+      ctx.pJobSystem = &jobSystem;
+      ctx.fanout = 8;
+      ctx.spin = 256;
+      ctStopwatch timer = ctStopwatch();
+      const int32_t count = job_test_run(jobSystem, ctx, 64, 8);
+      timer.NextLap();
+      jobSystem.JoinWorkers();
+      const double seconds = timer.GetDeltaTime();
+      if (threads == 1) { baseline = seconds; }
+      TEST_CHECK(count == 8 * 64 * (1 + ctx.fanout * 64));
+      ctDebugLog("Job System: %d threads %d jobs %.3fms (%.2fx)",
+                 threads,
+                 count,
+                 seconds * 1000.0,
+                 seconds > 0.0 ? baseline / seconds : 0.0);
+   }
+}
+
+struct DependencyTestContext {
+   ctAtomic stageA;
+   ctAtomic stageB;
+   ctAtomic stageC;
+   ctAtomic errors;
+   int32_t width;
+};
+
+static void dependency_test_a(void* data) {
+   DependencyTestContext* pCtx = (DependencyTestContext*)data;
+   ctAtomicAdd(pCtx->stageA, 1);
+}
+
+static void dependency_test_b(void* data) {
+   DependencyTestContext* pCtx = (DependencyTestContext*)data;
+   if (ctAtomicGet(pCtx->stageA) != pCtx->width) { ctAtomicAdd(pCtx->errors, 1); }
+   ctAtomicAdd(pCtx->stageB, 1);
+}
+
+static void dependency_test_c(void* data) {
+   DependencyTestContext* pCtx = (DependencyTestContext*)data;
+   if (ctAtomicGet(pCtx->stageB) != pCtx->width) { ctAtomicAdd(pCtx->errors, 1); }
+   ctAtomicAdd(pCtx->stageC, 1);
+}
+
+void job_dependency_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(4) == CT_SUCCESS);
+   ctJobSystemDependency depA = jobSystem.DeclareDependency("TestStageA");
+   ctJobSystemDependency depB = jobSystem.DeclareDependency("TestStageB");
+   ctJobSystemDependency depC = jobSystem.DeclareDependency("TestStageC");
+   TEST_CHECK(depA != 0 && depB != 0 && depC != 0);
+   TEST_CHECK(depA != depB && depB != depC);
+   TEST_CHECK(jobSystem.DeclareDependency("TestStageA") == depA);
+   /* these two share an XXH32 hash, they must still be told apart */
+   const ctJobSystemDependency collideA = jobSystem.DeclareDependency("Stage6717");
+   const ctJobSystemDependency collideB = jobSystem.DeclareDependency("Stage55950");
+   TEST_CHECK(ctXXHash32("Stage6717") == ctXXHash32("Stage55950"));
+   TEST_CHECK(collideA != 0 && collideB != 0 && collideA != collideB);
+   TEST_CHECK(jobSystem.DeclareDependency("Stage55950") == collideB);
+   TEST_CHECK(jobSystem.DeclareDependency("A dependency name that does not fit") == 0);
+
+   DependencyTestContext ctx;
+   ctx.width = 256;
+   ctAtomicSet(ctx.errors, 0);
+   void (*fpA[256])(void*);
+   void (*fpB[256])(void*);
+   void* pData[256];
+   for (int32_t i = 0; i < ctx.width; i++) {
+      fpA[i] = dependency_test_a;
+      fpB[i] = dependency_test_b;
+      pData[i] = &ctx;
+   }
+   for (int32_t round = 0; round < 64; round++) {
+      ctAtomicSet(ctx.stageA, 0);
+      ctAtomicSet(ctx.stageB, 0);
+      ctAtomicSet(ctx.stageC, 0);
+      /* stage A may already be running while the continuations register */
+      ctJobSystemDependency depsC[2] = {depA, depB};
+      jobSystem.PushJobs(ctx.width, fpA, pData, 0, NULL, depA);
+      jobSystem.PushJobs(ctx.width, fpB, pData, 1, &depA, depB);
+      jobSystem.PushJob(dependency_test_c, &ctx, 2, depsC, depC);
+      jobSystem.WaitForDependency(depC);
+      TEST_CHECK(jobSystem.isDependencyFinished(depA));
+      TEST_CHECK(jobSystem.isDependencyFinished(depB));
+      TEST_CHECK(ctAtomicGet(ctx.stageC) == 1);
+   }
+   TEST_CHECK(ctAtomicGet(ctx.errors) == 0);
+   jobSystem.WaitBarrier();
+   jobSystem.JoinWorkers();
+}
+
+static void parallel_for_test_range(size_t begin, size_t end, void* data) {
+   uint8_t* pVisits = (uint8_t*)data;
+   for (size_t i = begin; i < end; i++) {
+      pVisits[i]++;
+   }
+}
+
+void job_parallel_for_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(4) == CT_SUCCESS);
+   const size_t count = 100003;
+   uint8_t* pVisits = (uint8_t*)ctMalloc(count);
+   memset(pVisits, 0, count);
+   jobSystem.ParallelFor(0, count, 0, parallel_for_test_range, pVisits);
+   jobSystem.ParallelFor(0, count, 7, parallel_for_test_range, pVisits);
+   bool visitedTwice = true;
+   for (size_t i = 0; i < count; i++) {
+      if (pVisits[i] != 2) { visitedTwice = false; }
+   }
+   TEST_CHECK(visitedTwice);
+   ctFree(pVisits);
+
+   /* nested loops help out instead of blocking their worker */
+   ctAtomic total;
+   ctAtomicSet(total, 0);
+   jobSystem.ParallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+         jobSystem.ParallelFor(0, 1000, 0, [&](size_t innerBegin, size_t innerEnd) {
+            ctAtomicAdd(total, (int)(innerEnd - innerBegin));
+         });
+      }
+   });
+   TEST_CHECK(ctAtomicGet(total) == 64 * 1000);
+   TEST_CHECK(!jobSystem.isMoreWorkAvailible());
+   jobSystem.JoinWorkers();
+}
+
+void job_park_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(2) == CT_SUCCESS);
+   JobTestContext ctx;
+   ctx.pJobSystem = &jobSystem;
+   ctx.fanout = 0;
+   ctx.spin = 16;
+   for (int32_t round = 0; round < 4; round++) {
+      /* let the workers run out of spins and go to sleep */
+      ctWait(50);
+      ctAtomicSet(ctx.counter, 0);
+      for (int32_t i = 0; i < 32; i++) {
+         jobSystem.PushJob(job_test_leaf, &ctx);
+      }
+      /* don't help, the pushes alone have to wake someone up */
+      for (int32_t tries = 0; tries < 2000 && jobSystem.isMoreWorkAvailible(); tries++) {
+         ctWait(1);
+      }
+      TEST_CHECK(ctAtomicGet(ctx.counter) == 32);
+   }
+   jobSystem.JoinWorkers();
+}
+
+struct SuspendTestContext {
+   ctJobSystem* pJobSystem;
+   ctJobSystemDependency children;
+   ctAtomic childCount;
+   int32_t step;
+   int32_t seenAfterResume;
+};
+
+static void suspend_test_child(void* data) {
+   SuspendTestContext* pCtx = (SuspendTestContext*)data;
+   ctAtomicAdd(pCtx->childCount, 1);
+}
+
+/* resumes where it left off instead of blocking its worker on the children */
+static void suspend_test_parent(void* data) {
+   SuspendTestContext* pCtx = (SuspendTestContext*)data;
+   if (pCtx->step == 0) {
+      for (int32_t i = 0; i < 128; i++) {
+         pCtx->pJobSystem->PushJob(suspend_test_child, pCtx, 0, NULL, pCtx->children);
+      }
+      pCtx->step = 1;
+      pCtx->pJobSystem->SuspendJob(1, &pCtx->children);
+      return;
+   }
+   pCtx->seenAfterResume = ctAtomicGet(pCtx->childCount);
+   pCtx->step = 2;
+}
+
+void job_suspend_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(4) == CT_SUCCESS);
+   TEST_CHECK(jobSystem.SuspendJob(0, NULL) != CT_SUCCESS);
+   ctJobSystemDependency parents = jobSystem.DeclareDependency("SuspendParents");
+   SuspendTestContext ctx[16];
+   for (int32_t i = 0; i < 16; i++) {
+      ctx[i].pJobSystem = &jobSystem;
+      ctx[i].children = jobSystem.DeclareDependency(i % 2 ? "SuspendOdd" : "SuspendEven");
+      ctAtomicSet(ctx[i].childCount, 0);
+      ctx[i].step = 0;
+      ctx[i].seenAfterResume = -1;
+      jobSystem.PushJob(suspend_test_parent, &ctx[i], 0, NULL, parents);
+   }
+   jobSystem.WaitForDependency(parents);
+   for (int32_t i = 0; i < 16; i++) {
+      TEST_CHECK(ctx[i].step == 2);
+      TEST_CHECK(ctx[i].seenAfterResume == 128);
+   }
+   jobSystem.WaitBarrier();
+   jobSystem.JoinWorkers();
+}
+
+struct WaitInJobTestContext {
+   ctJobSystem* pJobSystem;
+   ctJobSystemDependency children;
+   ctAtomic childCount;
+   int32_t seenAfterWait;
+};
+
+static void wait_in_job_test_child(void* data) {
+   WaitInJobTestContext* pCtx = (WaitInJobTestContext*)data;
+   ctAtomicAdd(pCtx->childCount, 1);
+}
+
+/* blocks its worker (helping out) until only its own children are done */
+static void wait_in_job_test_parent(void* data) {
+   WaitInJobTestContext* pCtx = (WaitInJobTestContext*)data;
+   for (int32_t i = 0; i < 64; i++) {
+      pCtx->pJobSystem->PushJob(wait_in_job_test_child, pCtx, 0, NULL, pCtx->children);
+   }
+   pCtx->pJobSystem->WaitForDependency(pCtx->children);
+   pCtx->seenAfterWait = ctAtomicGet(pCtx->childCount);
+}
+
+void job_wait_in_job_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(4) == CT_SUCCESS);
+   WaitInJobTestContext ctx[16];
+   for (int32_t i = 0; i < 16; i++) {
+      ctx[i].pJobSystem = &jobSystem;
+      ctx[i].children = jobSystem.DeclareDependency(i % 2 ? "WaitOdd" : "WaitEven");
+      ctAtomicSet(ctx[i].childCount, 0);
+      ctx[i].seenAfterWait = -1;
+      jobSystem.PushJob(wait_in_job_test_parent, &ctx[i]);
+   }
+   /* waiting from outside of any job covers the parents and all their children */
+   jobSystem.WaitBarrier();
+   TEST_CHECK(!jobSystem.isMoreWorkAvailible());
+   for (int32_t i = 0; i < 16; i++) {
+      TEST_CHECK(ctx[i].seenAfterWait == 64);
+   }
+   jobSystem.JoinWorkers();
+}
+
+struct PriorityTestContext {
+   ctAtomic open;
+   ctAtomic order;
+   int32_t lastHigh;
+   int32_t firstBackground;
+};
+
+static void priority_test_gate(void* data) {
+   PriorityTestContext* pCtx = (PriorityTestContext*)data;
+   while (!ctAtomicGet(pCtx->open)) {
+      ctWait(1);
+   }
+}
+
+static void priority_test_high(void* data) {
+   PriorityTestContext* pCtx = (PriorityTestContext*)data;
+   const int32_t order = ctAtomicAdd(pCtx->order, 1);
+   if (order > pCtx->lastHigh) { pCtx->lastHigh = order; }
+}
+
+static void priority_test_background(void* data) {
+   PriorityTestContext* pCtx = (PriorityTestContext*)data;
+   const int32_t order = ctAtomicAdd(pCtx->order, 1);
+   if (order < pCtx->firstBackground) { pCtx->firstBackground = order; }
+}
+
+void job_priority_test(void) {
+   ZoneScoped;
+   /* a single worker and a host that never helps keeps the order deterministic */
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   TEST_ASSERT(jobSystem.SpawnWorkers(1) == CT_SUCCESS);
+   ctJobSystemDependency gate = jobSystem.DeclareDependency("PriorityGate");
+   PriorityTestContext ctx;
+   ctAtomicSet(ctx.open, 0);
+   ctAtomicSet(ctx.order, 0);
+   ctx.lastHigh = -1;
+   ctx.firstBackground = INT32_MAX;
+   jobSystem.PushJob(priority_test_gate, &ctx, 0, NULL, gate);
+   for (int32_t i = 0; i < 64; i++) {
+      jobSystem.PushJob(
+        priority_test_background, &ctx, 1, &gate, 0, CT_JOB_PRIORITY_BACKGROUND);
+      jobSystem.PushJob(priority_test_high, &ctx, 1, &gate, 0, CT_JOB_PRIORITY_HIGH);
+   }
+   ctAtomicSet(ctx.open, 1);
+   while (jobSystem.isMoreWorkAvailible()) {
+      ctWait(1);
+   }
+   TEST_CHECK(ctAtomicGet(ctx.order) == 128);
+   TEST_CHECK(ctx.lastHigh == 63);
+   TEST_CHECK(ctx.firstBackground == 64);
+   const ctJobLaneStats high = jobSystem.GetLaneStats(CT_JOB_PRIORITY_HIGH);
+   const ctJobLaneStats background = jobSystem.GetLaneStats(CT_JOB_PRIORITY_BACKGROUND);
+   TEST_CHECK(high.pushed == 64 && high.finished == 64 && high.queued == 0);
+   TEST_CHECK(background.pushed == 64 && background.finished == 64);
+   TEST_CHECK(jobSystem.GetLaneStats(CT_JOB_PRIORITY_NORMAL).pushed == 1);
+   jobSystem.JoinWorkers();
+}
+
+void job_telemetry_test(void) {
+   ZoneScoped;
+   ctJobSystem jobSystem = ctJobSystem(0, false);
+   jobSystem.SetTimelineSize(256);
+   TEST_ASSERT(jobSystem.SpawnWorkers(2) == CT_SUCCESS);
+   JobTestContext ctx;
+   ctx.pJobSystem = &jobSystem;
+   ctx.fanout = 1;
+   ctx.spin = 16;
+   const int32_t count = job_test_run(jobSystem, ctx, 8, 4);
+   uint64_t executed = 0;
+   for (size_t i = 0; i <= jobSystem.GetThreadCount(); i++) {
+      const ctJobWorkerStats stats = jobSystem.GetWorkerStats(i);
+      TEST_CHECK(stats.utilization >= 0.0 && stats.utilization <= 1.0);
+      executed += stats.executed;
+   }
+   TEST_CHECK(executed == (uint64_t)count);
+
+   const char* path = "JobSystemTestTrace.json";
+   ctFile file;
+   TEST_ASSERT(file.Open(path, CT_FILE_OPEN_WRITE_TEXT) == CT_SUCCESS);
+   TEST_CHECK(jobSystem.ExportChromeTrace(file) == CT_SUCCESS);
+   file.Close();
+   TEST_ASSERT(file.Open(path, CT_FILE_OPEN_READ_TEXT) == CT_SUCCESS);
+   ctStringUtf8 text;
+   file.GetText(text);
+   file.Close();
+   remove(path);
+   TEST_CHECK(strstr(text.CStr(), "\"traceEvents\"") != NULL);
+   TEST_CHECK(strstr(text.CStr(), "\"ph\":\"X\"") != NULL);
+
+   jobSystem.ResetStats();
+   TEST_CHECK(jobSystem.GetWorkerStats(0).executed == 0);
+   jobSystem.JoinWorkers();
+}
+
+/* the spin locked free list ctHandleManager used before it went lock free */
+struct handle_manager_locked {
+   handle_manager_locked() {
+      ctSpinLockInit(lock);
+      nextOpenIdx = 1;
+   }
+   ctHandle GetNewHandle() {
+      ctSpinLockEnterCriticalScoped(LOCK, lock);
+      if (freeList.isEmpty()) { return ctHandleMake(nextOpenIdx++, 0); }
+      const ctHandle result = freeList.Last();
+      freeList.RemoveLast();
+      return ctHandleMake(ctHandleGetIndex(result), ctHandleGetGeneration(result) + 1);
+   }
+   void FreeHandle(ctHandle hndl) {
+      ctSpinLockEnterCriticalScoped(LOCK, lock);
+      freeList.Append(hndl);
+   }
+   ctSpinLock lock;
+   ctDynamicArray<ctHandle> freeList;
+   uint32_t nextOpenIdx;
+};
+
+struct HandleContentionContext {
+   ctAtomic* pOwners; /* set while an index is handed out */
+   uint32_t ownerCount;
+   ctAtomic errors;
+};
+
+/* every job takes batches of handles and gives them back, an index that is handed out
+ twice while still held trips the owner table */
+template<class Manager>
+static double handle_contention_run(ctJobSystem& jobSystem,
+                                    Manager& manager,
+                                    HandleContentionContext& ctx,
+                                    size_t jobCount) {
+   ctStopwatch timer = ctStopwatch();
+   jobSystem.ParallelFor(0, jobCount, 1, [&](size_t begin, size_t end) {
+      ctHandle batch[64];
+      for (size_t j = begin; j < end; j++) {
+         for (int32_t round = 0; round < 16; round++) {
+            for (int32_t i = 0; i < 64; i++) {
+               batch[i] = manager.GetNewHandle();
+               const uint32_t index = ctHandleGetIndex(batch[i]);
+               if (index == 0 || index >= ctx.ownerCount ||
+                   !ctAtomicCompareExchange(ctx.pOwners[index], 0, 1)) {
+                  ctAtomicAdd(ctx.errors, 1);
+               }
+            }
+            for (int32_t i = 0; i < 64; i++) {
+               const uint32_t index = ctHandleGetIndex(batch[i]);
+               if (index < ctx.ownerCount) { ctAtomicSet(ctx.pOwners[index], 0); }
+               manager.FreeHandle(batch[i]);
+            }
+         }
+      }
+   });
+   timer.NextLap();
+   return timer.GetDeltaTime();
+}
+
+void handle_manager_contention_test(void) {
+   ZoneScoped;
+   const int32_t maxThreads = SDL_GetCPUCount();
+   HandleContentionContext ctx;
+   ctx.ownerCount = 64 * (maxThreads + 1) + 1;
+   ctx.pOwners = (ctAtomic*)ctMalloc(sizeof(ctAtomic) * ctx.ownerCount);
+   memset(ctx.pOwners, 0, sizeof(ctAtomic) * ctx.ownerCount);
+   ctAtomicSet(ctx.errors, 0);
+   const size_t jobCount = 512;
+   for (int32_t threads = 1; threads <= maxThreads; threads++) {
+      ctJobSystem jobSystem = ctJobSystem(0, false);
+      TEST_ASSERT(jobSystem.SpawnWorkers(threads) == CT_SUCCESS);
+      handle_manager_locked locked;
+      const double lockedSeconds =
+        handle_contention_run(jobSystem, locked, ctx, jobCount);
+      ctHandleManager manager;
+      const double lockFreeSeconds =
+        handle_contention_run(jobSystem, manager, ctx, jobCount);
+      jobSystem.JoinWorkers();
+      TEST_CHECK(ctAtomicGet(ctx.errors) == 0);
+      /* everything was given back, nothing leaked past the peak */
+      TEST_CHECK(ctHandleGetIndex(manager.GetNewHandle()) < ctx.ownerCount);
+      ctDebugLog("Handle Manager: %d threads %d handles locked %.3fms lock free %.3fms",
+                 threads,
+                 (int32_t)(jobCount * 16 * 64),
+                 lockedSeconds * 1000.0,
+                 lockFreeSeconds * 1000.0);
+   }
+   ctFree(ctx.pOwners);
+}
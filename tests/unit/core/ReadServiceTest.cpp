@@ -0,0 +1,101 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "utilities/Common.h"
+#include "core/ReadService.hpp"
+
+#define TEST_NO_MAIN
+#include "acutest/acutest.h"
+
+#define READ_TEST_FILE       "read_service_test.bin"
+#define READ_TEST_FILE_SIZE  (256 * 1024)
+#define READ_TEST_CHUNK_SIZE 4096
+#define READ_TEST_CHUNKS     (READ_TEST_FILE_SIZE / READ_TEST_CHUNK_SIZE)
+
+static void read_test_on_complete(ctReadRequest* pRequest, void* pUserData) {
+   ctAtomicAdd(*(ctAtomic*)pUserData, 1);
+}
+
+void read_service_test(void) {
+   ZoneScoped;
+   uint8_t* pSource = (uint8_t*)ctMalloc(READ_TEST_FILE_SIZE);
+   for (size_t i = 0; i < READ_TEST_FILE_SIZE; i++) {
+      pSource[i] = (uint8_t)((i * 31) ^ (i >> 8));
+   }
+   ctFile file = ctFile(READ_TEST_FILE, CT_FILE_OPEN_WRITE);
+   TEST_ASSERT(file.isOpen());
+   file.WriteRaw(pSource, 1, READ_TEST_FILE_SIZE);
+   file.Close();
+
+   ctReadService service = ctReadService(false);
+   TEST_ASSERT(service.SpawnThreads(4) == CT_SUCCESS);
+   ctReadServiceFile readFile = service.OpenFile(READ_TEST_FILE);
+   TEST_ASSERT(readFile != NULL);
+   TEST_CHECK(service.GetFileSize(readFile) == READ_TEST_FILE_SIZE);
+
+   /* every chunk in reverse, they should land in place regardless of order */
+   uint8_t* pDest = (uint8_t*)ctMalloc(READ_TEST_FILE_SIZE);
+   memset(pDest, 0, READ_TEST_FILE_SIZE);
+   ctAtomic callbacks;
+   ctAtomicSet(callbacks, 0);
+   ctReadRequest requests[READ_TEST_CHUNKS];
+   for (size_t i = 0; i < READ_TEST_CHUNKS; i++) {
+      const size_t chunk = READ_TEST_CHUNKS - 1 - i;
+      requests[i] = ctReadRequest();
+      requests[i].file = readFile;
+      requests[i].offset = (int64_t)(chunk * READ_TEST_CHUNK_SIZE);
+      requests[i].size = READ_TEST_CHUNK_SIZE;
+      requests[i].pDest = pDest + chunk * READ_TEST_CHUNK_SIZE;
+      requests[i].fpOnComplete = read_test_on_complete;
+      requests[i].pUserData = &callbacks;
+   }
+   ctReadBatch batch;
+   TEST_CHECK(service.Submit(batch, requests, READ_TEST_CHUNKS) == CT_SUCCESS);
+   TEST_CHECK(service.Wait(batch) == CT_SUCCESS);
+   TEST_CHECK(service.isFinished(batch));
+   TEST_CHECK(ctAtomicGet(callbacks) == READ_TEST_CHUNKS);
+   TEST_CHECK(memcmp(pSource, pDest, READ_TEST_FILE_SIZE) == 0);
+
+   /* reading past the end comes back short and fails the batch */
+   uint8_t tail[64];
+   ctReadRequest shortRequest = ctReadRequest();
+   shortRequest.file = readFile;
+   shortRequest.offset = READ_TEST_FILE_SIZE - 16;
+   shortRequest.size = sizeof(tail);
+   shortRequest.pDest = tail;
+   ctReadBatch shortBatch;
+   TEST_CHECK(service.Submit(shortBatch, &shortRequest, 1) == CT_SUCCESS);
+   TEST_CHECK(service.Wait(shortBatch) != CT_SUCCESS);
+   TEST_CHECK(shortRequest.bytesRead == 16);
+   TEST_CHECK(shortRequest.result == CT_FAILURE_CORRUPTED_CONTENTS);
+   TEST_CHECK(memcmp(tail, pSource + READ_TEST_FILE_SIZE - 16, 16) == 0);
+
+   /* reads still queued when the threads stop fail instead of hanging the wait */
+   service.JoinThreads();
+   ctReadRequest leftRequest = shortRequest;
+   leftRequest.offset = 0;
+   ctReadBatch leftBatch;
+   TEST_CHECK(service.Submit(leftBatch, &leftRequest, 1) == CT_SUCCESS);
+   TEST_CHECK(!service.isFinished(leftBatch));
+   service.JoinThreads();
+   TEST_CHECK(service.Wait(leftBatch) != CT_SUCCESS);
+   TEST_CHECK(leftRequest.result == CT_FAILURE_SKIPPED);
+
+   service.CloseFile(readFile);
+   ctFree(pDest);
+   remove(READ_TEST_FILE);
+   ctFree(pSource);
+}
@@ -0,0 +1,480 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "utilities/Common.h"
+#include "utilities/FrameArena.hpp"
+#include "utilities/VirtualArray.hpp"
+#include "system/System.h"
+
+#define TEST_NO_MAIN
+#include "acutest/acutest.h"
+
+struct FrameArenaTestItem {
+   int32_t value;
+   FrameArenaTestItem() {
+      value = 7;
+   }
+};
+
+void frame_arena_test(void) {
+   ZoneScoped;
+   ctFrameArena arena = ctFrameArena(1024);
+
+   /* allocations respect alignment and don't overlap */
+   uint8_t* pA = (uint8_t*)arena.Alloc(3, 1);
+   uint8_t* pB = (uint8_t*)arena.Alloc(64, 64);
+   TEST_CHECK(((size_t)pB & 63) == 0);
+   TEST_CHECK(pB >= pA + 3);
+   memset(pA, 0xAA, 3);
+   memset(pB, 0xBB, 64);
+   TEST_CHECK(pA[2] == 0xAA);
+   TEST_CHECK(arena.GetStats().overflows == 0);
+
+   /* running out chains on a new block instead of failing */
+   uint8_t* pBig = (uint8_t*)arena.Alloc(4000, 16);
+   memset(pBig, 0xCC, 4000);
+   TEST_CHECK(pB[63] == 0xBB);
+   ctFrameArenaStats stats = arena.GetStats();
+   TEST_CHECK(stats.overflows == 1);
+   TEST_CHECK(stats.used >= 4067);
+   TEST_CHECK(stats.highWater == stats.used);
+
+   /* the next frame fits in a single block */
+   arena.Reset();
+   stats = arena.GetStats();
+   TEST_CHECK(stats.used == 0);
+   TEST_CHECK(stats.capacity >= stats.highWater);
+   arena.Alloc(4000, 16);
+   arena.Alloc(64, 64);
+   TEST_CHECK(arena.GetStats().overflows == 1);
+
+   /* arrays can live in the arena and grow in it */
+   arena.Reset();
+   {
+      ctDynamicArray<FrameArenaTestItem, ctFrameArenaAllocator> items(&arena);
+      for (int32_t i = 0; i < 100; i++) {
+         items.Append(FrameArenaTestItem());
+         items.Last().value = i;
+      }
+      TEST_CHECK(items.Count() == 100);
+      TEST_CHECK(items[99].value == 99);
+      TEST_CHECK(items[0].value == 0);
+      TEST_CHECK(arena.GetStats().used >= 100 * sizeof(FrameArenaTestItem));
+
+      /* copies don't keep pointing into the arena */
+      ctDynamicArray<FrameArenaTestItem> copy = items;
+      arena.Reset();
+      TEST_CHECK(copy[42].value == 42);
+   }
+
+   /* every thread gets its own arena */
+   ctFrameArena* pLocal = ctGetFrameArena();
+   TEST_CHECK(pLocal == ctGetFrameArena());
+   ctFrameArenaResetAll();
+   ctFrameArenaResetThread();
+   void* pFirstAlloc = pLocal->Alloc(128);
+   TEST_CHECK(ctFrameArenaGetTotalStats().used >= 128);
+   /* only resets once per frame */
+   ctFrameArenaResetThread();
+   TEST_CHECK(pLocal->GetStats().used >= 128);
+
+   /* frame memory stays valid across the end of the frame until the thread resets */
+   {
+      ctDynamicArray<FrameArenaTestItem, ctFrameArenaAllocator> items;
+      for (int32_t i = 0; i < 16; i++) {
+         items.Append(FrameArenaTestItem());
+         items.Last().value = i;
+      }
+      ctFrameArenaResetAll();
+      for (int32_t i = 16; i < 1000; i++) {
+         items.Append(FrameArenaTestItem());
+         items.Last().value = i;
+      }
+      bool intact = true;
+      for (int32_t i = 0; i < 1000; i++) {
+         if (items[i].value != i) { intact = false; }
+      }
+      TEST_CHECK(intact);
+      TEST_CHECK(pLocal->GetStats().used >= 1000 * sizeof(FrameArenaTestItem));
+   }
+   ctFrameArenaResetThread();
+   TEST_CHECK(pLocal->GetStats().used == 0);
+   TEST_CHECK(pLocal->Alloc(128) == pFirstAlloc);
+   ctFrameArenaResetAll();
+   ctFrameArenaResetThread();
+}
+
+static int small_alloc_free_thread(void* data) {
+   void** ppBlocks = (void**)data;
+   for (size_t i = 0; i < 256; i++) {
+      ctFree(ppBlocks[i]);
+   }
+   return 0;
+}
+
+void small_alloc_pool_test(void) {
+   ZoneScoped;
+   const size_t aliveBefore = ctGetAliveAllocations();
+
+   /* under a cache line only 16 byte alignment is promised */
+   const size_t sizes[] = {1, 12, 16, 33, 48, 64, 65, 200, 512, 513, 4096};
+   void* blocks[sizeof(sizes) / sizeof(sizes[0])];
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      blocks[i] = ctMalloc(sizes[i]);
+      TEST_ASSERT(blocks[i]);
+      const size_t alignment = sizes[i] < CT_ALIGNMENT_CACHE ? 16 : CT_ALIGNMENT_CACHE;
+      TEST_CHECK_(((size_t)blocks[i] & (alignment - 1)) == 0, "size %d", (int)sizes[i]);
+      memset(blocks[i], (int)i, sizes[i]);
+   }
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      TEST_CHECK(((uint8_t*)blocks[i])[sizes[i] - 1] == (uint8_t)i);
+      ctFree(blocks[i]);
+   }
+
+   /* realloc keeps the block while it still fits the class */
+   uint8_t* pGrow = (uint8_t*)ctMalloc(40);
+   memset(pGrow, 0x5A, 40);
+   TEST_CHECK(ctRealloc(pGrow, 48) == pGrow);
+   pGrow = (uint8_t*)ctRealloc(pGrow, 1000);
+   TEST_CHECK(pGrow[39] == 0x5A);
+   pGrow = (uint8_t*)ctRealloc(pGrow, 20);
+   TEST_CHECK(pGrow[19] == 0x5A);
+   ctFree(pGrow);
+
+   /* blocks can be freed from other threads */
+   void* crossThread[256];
+   for (size_t i = 0; i < 256; i++) {
+      crossThread[i] = ctMalloc(8 + i);
+   }
+   ctThread thread = ctThreadCreate(small_alloc_free_thread, crossThread, "Free");
+   ctThreadWaitForExit(thread);
+
+   TEST_CHECK(ctGetAliveAllocations() == aliveBefore);
+}
+
+/* random sizes in the range most engine allocations fall in */
+static inline size_t small_alloc_size(uint32_t& seed) {
+   seed = seed * 1664525u + 1013904223u;
+   return 8 + (seed >> 16) % 248;
+}
+
+static void small_alloc_benchmark_run(const char* name,
+                                      void* (*fpAlloc)(size_t),
+                                      void (*fpFree)(void*)) {
+   const size_t liveCount = 200000;
+   const size_t churnCount = 2000000;
+   const size_t window = 1024;
+   void** ppBlocks = (void**)ctAlignedMalloc(sizeof(void*) * liveCount, 64);
+   uint32_t seed = 1234;
+
+   /* footprint of many live objects */
+   const size_t residentBefore = ctSystemGetResidentMemory();
+   size_t requested = 0;
+   ctStopwatch timer = ctStopwatch();
+   for (size_t i = 0; i < liveCount; i++) {
+      const size_t size = small_alloc_size(seed);
+      ppBlocks[i] = fpAlloc(size);
+      memset(ppBlocks[i], 1, size);
+      requested += size;
+   }
+   timer.NextLap();
+   const double fillSeconds = timer.GetDeltaTime();
+   const size_t residentAfter = ctSystemGetResidentMemory();
+   for (size_t i = 0; i < liveCount; i++) {
+      fpFree(ppBlocks[i]);
+   }
+
+   /* throughput of short lived objects */
+   for (size_t i = 0; i < window; i++) {
+      ppBlocks[i] = fpAlloc(small_alloc_size(seed));
+   }
+   timer.NextLap();
+   for (size_t i = 0; i < churnCount; i++) {
+      const size_t slot = (seed >> 8) % window;
+      fpFree(ppBlocks[slot]);
+      ppBlocks[slot] = fpAlloc(small_alloc_size(seed));
+   }
+   timer.NextLap();
+   const double churnSeconds = timer.GetDeltaTime();
+   for (size_t i = 0; i < window; i++) {
+      fpFree(ppBlocks[i]);
+   }
+   ctAlignedFree(ppBlocks);
+
+   const size_t resident =
+     residentAfter > residentBefore ? residentAfter - residentBefore : 0;
+   ctDebugLog("%s: %.1fMB resident for %.1fMB requested (%.2fx), "
+              "fill %.2fns/alloc, churn %.2fns/pair",
+              name,
+              (double)resident / (1024.0 * 1024.0),
+              (double)requested / (1024.0 * 1024.0),
+              requested ? (double)resident / (double)requested : 0.0,
+              fillSeconds * 1e9 / (double)liveCount,
+              churnSeconds * 1e9 / (double)churnCount);
+}
+
+static void* small_alloc_legacy(size_t size) {
+   return ctAlignedMalloc(size, CT_ALIGNMENT_CACHE);
+}
+
+void small_alloc_benchmark_test(void) {
+   ZoneScoped;
+   const size_t aliveBefore = ctGetAliveAllocations();
+   /* pools keep their slabs, run them first so the heap path can't reuse them */
+   small_alloc_benchmark_run("Pooled ctMalloc", ctMalloc, ctFree);
+   small_alloc_benchmark_run(
+     "Tracked ctAlignedMalloc", small_alloc_legacy, ctAlignedFree);
+   TEST_CHECK(ctGetAliveAllocations() == aliveBefore);
+}
+
+static bool realloc_test_check(const uint8_t* pData, size_t size) {
+   for (size_t i = 0; i < size; i++) {
+      if (pData[i] != (uint8_t)(i * 7)) { return false; }
+   }
+   return true;
+}
+
+static void realloc_test_fill(uint8_t* pData, size_t begin, size_t end) {
+   for (size_t i = begin; i < end; i++) {
+      pData[i] = (uint8_t)(i * 7);
+   }
+}
+
+void realloc_in_place_test(void) {
+   ZoneScoped;
+   const size_t aliveBefore = ctGetAliveAllocations();
+
+   /* large blocks keep their contents and alignment across growth and shrinking */
+   const size_t alignments[] = {16, CT_ALIGNMENT_CACHE, 4096};
+   for (size_t a = 0; a < sizeof(alignments) / sizeof(alignments[0]); a++) {
+      const size_t alignment = alignments[a];
+      size_t size = 1024 * 1024;
+      uint8_t* pData = (uint8_t*)ctAlignedMalloc(size, alignment);
+      realloc_test_fill(pData, 0, size);
+      pData = (uint8_t*)ctAlignedRealloc(pData, 32 * 1024 * 1024, alignment);
+      TEST_CHECK(((size_t)pData & (alignment - 1)) == 0);
+      TEST_CHECK(realloc_test_check(pData, size));
+      realloc_test_fill(pData, size, 32 * 1024 * 1024);
+      size = 4096;
+      pData = (uint8_t*)ctAlignedRealloc(pData, size, alignment);
+      TEST_CHECK(((size_t)pData & (alignment - 1)) == 0);
+      TEST_CHECK(realloc_test_check(pData, size));
+      ctAlignedFree(pData);
+   }
+
+   /* stepwise growth like a WAD blob being written, through the pools and out */
+   size_t size = 0;
+   uint8_t* pBlob = NULL;
+   for (size_t step = 0; step < 512; step++) {
+      const size_t newSize = size + 24 + step * 64;
+      pBlob = (uint8_t*)ctRealloc(pBlob, newSize);
+      TEST_ASSERT(pBlob);
+      realloc_test_fill(pBlob, size, newSize);
+      size = newSize;
+   }
+   TEST_CHECK(((size_t)pBlob & (CT_ALIGNMENT_CACHE - 1)) == 0);
+   TEST_CHECK(realloc_test_check(pBlob, size));
+   ctFree(pBlob);
+
+   /* asking for more alignment than a pooled block has moves it */
+   uint8_t* pSmall = (uint8_t*)ctMalloc(24);
+   realloc_test_fill(pSmall, 0, 24);
+   pSmall = (uint8_t*)ctAlignedRealloc(pSmall, 24, 256);
+   TEST_CHECK(((size_t)pSmall & 255) == 0);
+   TEST_CHECK(realloc_test_check(pSmall, 24));
+   ctAlignedFree(pSmall);
+
+   TEST_CHECK(ctGetAliveAllocations() == aliveBefore);
+}
+
+void memory_tag_test(void) {
+   ZoneScoped;
+   TEST_CHECK(ctMemoryTagGetCurrent() == CT_MEMORY_TAG_GENERAL);
+   const ctMemoryTagStats before = ctMemoryTagGetStats(CT_MEMORY_TAG_GAME);
+   const ctMemoryTagStats physicsBefore = ctMemoryTagGetStats(CT_MEMORY_TAG_PHYSICS);
+
+   void* pBlocks[100];
+   void* pLarge = NULL;
+   void* pNested = NULL;
+   {
+      ctMemoryTagScoped(CT_MEMORY_TAG_GAME);
+      TEST_CHECK(ctMemoryTagGetCurrent() == CT_MEMORY_TAG_GAME);
+      for (int i = 0; i < 100; i++) {
+         pBlocks[i] = ctMalloc(40); /* 48 byte class */
+      }
+      pLarge = ctMalloc(4096);
+      ctMemoryTagPush(CT_MEMORY_TAG_PHYSICS);
+      pNested = ctMalloc(4096);
+      ctMemoryTagPop();
+      TEST_CHECK(ctMemoryTagGetCurrent() == CT_MEMORY_TAG_GAME);
+   }
+   TEST_CHECK(ctMemoryTagGetCurrent() == CT_MEMORY_TAG_GENERAL);
+
+   ctMemoryTagStats stats = ctMemoryTagGetStats(CT_MEMORY_TAG_GAME);
+   TEST_CHECK(stats.bytes - before.bytes == 100 * 48 + 4096);
+   TEST_CHECK(stats.count - before.count == 101);
+   TEST_CHECK(stats.highWater >= stats.bytes);
+   TEST_CHECK(ctMemoryTagGetStats(CT_MEMORY_TAG_PHYSICS).bytes - physicsBefore.bytes ==
+              4096);
+
+   /* growing is charged to the tag the block was made with */
+   pLarge = ctRealloc(pLarge, 8192);
+   stats = ctMemoryTagGetStats(CT_MEMORY_TAG_GAME);
+   TEST_CHECK(stats.bytes - before.bytes == 100 * 48 + 8192);
+   TEST_CHECK(stats.count - before.count == 101);
+
+   for (int i = 0; i < 100; i++) {
+      ctFree(pBlocks[i]);
+   }
+   ctFree(pLarge);
+   ctFree(pNested);
+   stats = ctMemoryTagGetStats(CT_MEMORY_TAG_GAME);
+   TEST_CHECK(stats.bytes == before.bytes);
+   TEST_CHECK(stats.count == before.count);
+   TEST_CHECK(stats.highWater >= before.bytes + 100 * 48 + 8192);
+   TEST_CHECK(ctMemoryTagGetStats(CT_MEMORY_TAG_PHYSICS).bytes == physicsBefore.bytes);
+
+   ctMemoryTagResetHighWater();
+   TEST_CHECK(ctMemoryTagGetStats(CT_MEMORY_TAG_GAME).highWater < stats.highWater);
+   TEST_CHECK(strcmp(ctMemoryTagGetName(CT_MEMORY_TAG_PHYSICS), "Physics") == 0);
+}
+
+struct AllocatorTestCounter {
+   void* Allocate(size_t size, size_t alignment) {
+      (*pAllocations)++;
+      return ctAlignedMalloc(size, alignment);
+   }
+   void Free(void* pBlock, size_t size) {
+      (*pAllocations)--;
+      ctAlignedFree(pBlock);
+   }
+   int* pAllocations;
+};
+
+void container_allocator_test(void) {
+   ZoneScoped;
+   /* stateless policies add nothing to the containers */
+   TEST_CHECK(sizeof(ctDynamicArray<int>) == sizeof(void*) + 3 * sizeof(size_t));
+   TEST_CHECK(sizeof(ctDynamicArray<int, ctTaggedAllocator<CT_MEMORY_TAG_GAME>>) ==
+              sizeof(ctDynamicArray<int>));
+
+   int allocations = 0;
+   AllocatorTestCounter counter = {&allocations};
+   {
+      ctDynamicArray<uint64_t, AllocatorTestCounter> values(counter);
+      for (uint64_t i = 0; i < 1000; i++) {
+         values.Append(i * 3);
+      }
+      TEST_CHECK(allocations == 1);
+      TEST_CHECK(values[999] == 2997);
+
+      /* copies keep the policy, conversions use their own */
+      ctDynamicArray<uint64_t, AllocatorTestCounter> copy = values;
+      TEST_CHECK(allocations == 2);
+      ctDynamicArray<uint64_t> heapCopy = values;
+      TEST_CHECK(allocations == 2);
+      TEST_CHECK(heapCopy.Count() == 1000 && heapCopy[500] == 1500);
+      heapCopy.Append(copy);
+      TEST_CHECK(heapCopy.Count() == 2000 && heapCopy[1999] == 2997);
+
+      ctHashTable<uint64_t, uint32_t, AllocatorTestCounter> table(counter);
+      for (uint32_t i = 1; i <= 500; i++) {
+         table.Insert(i, i * 7);
+      }
+      TEST_CHECK(allocations > 2);
+      ctHashTable<uint64_t, uint32_t, AllocatorTestCounter> tableCopy = table;
+      TEST_CHECK(tableCopy.Count() == 500);
+      TEST_CHECK(*tableCopy.FindPtr(321) == 321 * 7);
+   }
+   TEST_CHECK(allocations == 0);
+
+   /* tagged containers are charged to their tag wherever they grow */
+   const ctMemoryTagStats before = ctMemoryTagGetStats(CT_MEMORY_TAG_ANIMATION);
+   {
+      ctHashTable<float, uint32_t, ctTaggedAllocator<CT_MEMORY_TAG_ANIMATION>> table;
+      for (uint32_t i = 1; i <= 100; i++) {
+         table.Insert(i, (float)i);
+      }
+      TEST_CHECK(ctMemoryTagGetStats(CT_MEMORY_TAG_ANIMATION).bytes > before.bytes);
+      TEST_CHECK(*table.FindPtr(42) == 42.0f);
+   }
+   TEST_CHECK(ctMemoryTagGetStats(CT_MEMORY_TAG_ANIMATION).bytes == before.bytes);
+
+   /* scratch containers from the thread's frame arena */
+   {
+      ctDynamicArray<int32_t, ctFrameArenaAllocator> scratch;
+      scratch.Append(5, 64);
+      TEST_CHECK(ctGetFrameArena()->GetStats().used >= 64 * sizeof(int32_t));
+      TEST_CHECK(scratch[63] == 5);
+   }
+   ctFrameArenaResetAll();
+   ctFrameArenaResetThread();
+}
+
+struct VirtualArrayTestItem {
+   VirtualArrayTestItem() {
+      value = -1;
+   }
+   VirtualArrayTestItem(int64_t v) {
+      value = v;
+   }
+   int64_t value;
+   int64_t padding[3];
+};
+
+void virtual_array_test(void) {
+   ZoneScoped;
+   const size_t pageSize = ctVirtualPageSize();
+   TEST_ASSERT(pageSize && (pageSize & (pageSize - 1)) == 0);
+
+   /* nothing is reserved until it grows */
+   ctVirtualArray<VirtualArrayTestItem> items((size_t)1024 * 1024 * 1024);
+   TEST_CHECK(items.Data() == NULL);
+   TEST_CHECK(items.MaxCount() == (size_t)1024 * 1024 * 1024 / 32);
+
+   /* growth never moves the elements */
+   TEST_CHECK(items.Append(VirtualArrayTestItem(0)) == CT_SUCCESS);
+   const VirtualArrayTestItem* pFirst = &items[0];
+   for (int64_t i = 1; i < 1000000; i++) {
+      items.Append(VirtualArrayTestItem(i));
+   }
+   TEST_CHECK(&items[0] == pFirst);
+   TEST_CHECK(items.Count() == 1000000);
+   TEST_CHECK(items[999999].value == 999999);
+   TEST_CHECK(items.Capacity() >= items.Count());
+   TEST_CHECK(items.Capacity() * sizeof(VirtualArrayTestItem) < 48 * 1024 * 1024);
+
+   /* resizing constructs and destructs in place */
+   TEST_CHECK(items.Resize(1000010) == CT_SUCCESS);
+   TEST_CHECK(items.Last().value == -1);
+   TEST_CHECK(items.Resize(10) == CT_SUCCESS);
+   items.Shrink();
+   TEST_CHECK(items.Capacity() * sizeof(VirtualArrayTestItem) == pageSize);
+   TEST_CHECK(items[9].value == 9);
+   TEST_CHECK(&items[0] == pFirst);
+
+   /* appending past the reservation fails without touching the array */
+   ctVirtualArray<uint8_t> small(pageSize);
+   TEST_CHECK(small.Append(7, pageSize) == CT_SUCCESS);
+   TEST_CHECK(small.Append(8) == CT_FAILURE_OUT_OF_MEMORY);
+   TEST_CHECK(small.Count() == pageSize && small.Last() == 7);
+
+   ctDynamicArray<uint8_t> bytes;
+   bytes.Append(3, 100);
+   ctVirtualArray<uint8_t> copy;
+   TEST_CHECK(copy.Append(bytes) == CT_SUCCESS);
+   TEST_CHECK(copy.Count() == 100 && copy[99] == 3);
+}
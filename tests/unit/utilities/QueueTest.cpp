@@ -0,0 +1,267 @@
+/*
+   Copyright 2022 MacKenzie Strand
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "utilities/Common.h"
+#include "utilities/RingBuffer.hpp"
+#include "utilities/SPSCQueue.hpp"
+#include "utilities/MPMCQueue.hpp"
+
+#define TEST_NO_MAIN
+#include "acutest/acutest.h"
+
+/* Spin a little then give the timeslice away, the threads may share a core */
+static void queue_test_backoff(int& attempts) {
+   if (++attempts < 64) {
+      ctAtomicSpinPause();
+   } else {
+      ctWait(0);
+   }
+}
+
+/* Serializes a ctRingBuffer behind a spin lock, what the engine used so far */
+template<class T>
+struct queue_test_locked {
+   queue_test_locked(size_t capacity) {
+      ctSpinLockInit(lock);
+      this->capacity = capacity;
+      ring.Reserve(capacity);
+   }
+   bool Push(const T& val) {
+      ctSpinLockEnterCritical(lock);
+      const bool pushed = ring.Count() < capacity;
+      if (pushed) { ring.Append(val); }
+      ctSpinLockExitCritical(lock);
+      return pushed;
+   }
+   bool Pop(T& out) {
+      ctSpinLockEnterCritical(lock);
+      const bool popped = ring.PopFront(out);
+      ctSpinLockExitCritical(lock);
+      return popped;
+   }
+   ctSpinLock lock;
+   size_t capacity;
+   ctRingBuffer<T> ring;
+};
+
+/* Producer index in the high bits, sequence in the low bits */
+template<class Queue>
+struct queue_test_context {
+   Queue* pQueue;
+   int64_t itemsPerProducer;
+   int32_t producerIndex;
+   ctAtomic64* pConsumed;
+   int64_t totalItems;
+   int64_t sum;
+   bool ordered;
+};
+
+template<class Queue>
+static int queue_test_producer(void* pData) {
+   queue_test_context<Queue>* pContext = (queue_test_context<Queue>*)pData;
+   const uint64_t tag = (uint64_t)pContext->producerIndex << 32;
+   for (int64_t i = 0; i < pContext->itemsPerProducer; i++) {
+      int attempts = 0;
+      while (!pContext->pQueue->Push(tag | (uint64_t)i)) {
+         queue_test_backoff(attempts);
+      }
+   }
+   return 0;
+}
+
+/* Items from one producer must come out in the order they went in */
+template<class Queue>
+static int queue_test_consumer(void* pData) {
+   queue_test_context<Queue>* pContext = (queue_test_context<Queue>*)pData;
+   int64_t lastSequence[8];
+   for (int i = 0; i < 8; i++) {
+      lastSequence[i] = -1;
+   }
+   while (ctAtomic64Get(*pContext->pConsumed) < pContext->totalItems) {
+      uint64_t item;
+      int attempts = 0;
+      while (!pContext->pQueue->Pop(item)) {
+         if (ctAtomic64Get(*pContext->pConsumed) >= pContext->totalItems) { return 0; }
+         queue_test_backoff(attempts);
+      }
+      const int32_t producer = (int32_t)(item >> 32);
+      const int64_t sequence = (int64_t)(item & 0xFFFFFFFF);
+      pContext->ordered &= sequence > lastSequence[producer];
+      lastSequence[producer] = sequence;
+      pContext->sum += sequence;
+      ctAtomic64Add(*pContext->pConsumed, 1);
+   }
+   return 0;
+}
+
+/* Returns seconds taken, checks nothing was lost, duplicated or reordered */
+template<class Queue>
+static double
+queue_test_run(Queue& queue, int32_t producers, int32_t consumers, int64_t perProducer) {
+   ctAssert(producers <= 8 && consumers <= 8);
+   ctAtomic64 consumed;
+   ctAtomic64Set(consumed, 0);
+   queue_test_context<Queue> contexts[16];
+   ctThread threads[16];
+   const int32_t threadCount = producers + consumers;
+   for (int32_t i = 0; i < threadCount; i++) {
+      contexts[i].pQueue = &queue;
+      contexts[i].itemsPerProducer = perProducer;
+      contexts[i].producerIndex = i;
+      contexts[i].pConsumed = &consumed;
+      contexts[i].totalItems = perProducer * producers;
+      contexts[i].sum = 0;
+      contexts[i].ordered = true;
+   }
+   ctStopwatch timer = ctStopwatch();
+   for (int32_t i = 0; i < consumers; i++) {
+      threads[producers + i] = ctThreadCreate(
+        queue_test_consumer<Queue>, &contexts[producers + i], "Queue Consumer");
+   }
+   for (int32_t i = 0; i < producers; i++) {
+      threads[i] =
+        ctThreadCreate(queue_test_producer<Queue>, &contexts[i], "Queue Producer");
+   }
+   for (int32_t i = 0; i < threadCount; i++) {
+      ctThreadWaitForExit(threads[i]);
+   }
+   timer.NextLap();
+
+   int64_t sum = 0;
+   bool ordered = true;
+   for (int32_t i = producers; i < threadCount; i++) {
+      sum += contexts[i].sum;
+      ordered &= contexts[i].ordered;
+   }
+   TEST_CHECK(ctAtomic64Get(consumed) == perProducer * producers);
+   TEST_CHECK(sum == producers * (perProducer * (perProducer - 1) / 2));
+   TEST_CHECK(ordered);
+   return timer.GetDeltaTime();
+}
+
+static int gQueueTestAlive = 0;
+struct queue_test_item {
+   queue_test_item() {
+      gQueueTestAlive++;
+      value = 0;
+   }
+   queue_test_item(int value) {
+      gQueueTestAlive++;
+      this->value = value;
+   }
+   queue_test_item(const queue_test_item& other) {
+      gQueueTestAlive++;
+      value = other.value;
+   }
+   queue_test_item& operator=(const queue_test_item& other) {
+      value = other.value;
+      return *this;
+   }
+   ~queue_test_item() {
+      gQueueTestAlive--;
+   }
+   int value;
+};
+
+void spsc_queue_test(void) {
+   ZoneScoped;
+   {
+      ctSPSCQueue<queue_test_item> queue;
+      TEST_CHECK(queue.Reserve(12) == CT_FAILURE_INVALID_PARAMETER);
+      TEST_CHECK(queue.Reserve(8) == CT_SUCCESS);
+      TEST_CHECK(queue.Reserve(16) == CT_FAILURE_NOT_UPDATABLE);
+      queue_test_item item;
+      /* wrap around the storage a few times */
+      bool fifo = true;
+      for (int lap = 0; lap < 4; lap++) {
+         for (int i = 0; i < 8; i++) {
+            fifo &= queue.Push(queue_test_item(lap * 8 + i));
+         }
+         fifo &= !queue.Push(queue_test_item(-1));
+         fifo &= queue.Count() == 8;
+         for (int i = 0; i < 8; i++) {
+            fifo &= queue.Pop(item) && item.value == lap * 8 + i;
+         }
+         fifo &= !queue.Pop(item) && queue.isEmpty();
+      }
+      TEST_CHECK(fifo);
+      queue.Push(item);
+      queue.Push(item);
+   }
+   /* whatever was left inside is destroyed with the queue */
+   TEST_CHECK(gQueueTestAlive == 0);
+
+   ctSPSCQueue<uint64_t> queue;
+   queue.Reserve(256);
+   queue_test_run(queue, 1, 1, 1000000);
+}
+
+void mpmc_queue_test(void) {
+   ZoneScoped;
+   {
+      ctMPMCQueue<queue_test_item> queue;
+      TEST_CHECK(queue.Reserve(1) == CT_FAILURE_INVALID_PARAMETER);
+      TEST_CHECK(queue.Reserve(8) == CT_SUCCESS);
+      queue_test_item item;
+      bool fifo = true;
+      for (int lap = 0; lap < 4; lap++) {
+         for (int i = 0; i < 8; i++) {
+            fifo &= queue.Push(queue_test_item(lap * 8 + i));
+         }
+         fifo &= !queue.Push(queue_test_item(-1));
+         for (int i = 0; i < 8; i++) {
+            fifo &= queue.Pop(item) && item.value == lap * 8 + i;
+         }
+         fifo &= !queue.Pop(item) && queue.isEmpty();
+      }
+      TEST_CHECK(fifo);
+      queue.Push(item);
+   }
+   TEST_CHECK(gQueueTestAlive == 0);
+
+   /* a small capacity keeps producers and consumers racing over the same cells */
+   ctMPMCQueue<uint64_t> queue;
+   queue.Reserve(64);
+   queue_test_run(queue, 4, 4, 200000);
+   ctMPMCQueue<uint64_t> fanIn;
+   fanIn.Reserve(1024);
+   queue_test_run(fanIn, 6, 1, 100000);
+}
+
+void concurrent_queue_benchmark_test(void) {
+   ZoneScoped;
+   const int64_t items = 2000000;
+   {
+      ctSPSCQueue<uint64_t> spsc;
+      spsc.Reserve(1024);
+      queue_test_locked<uint64_t> locked(1024);
+      const double lockedSeconds = queue_test_run(locked, 1, 1, items);
+      const double spscSeconds = queue_test_run(spsc, 1, 1, items);
+      ctDebugLog("1 producer 1 consumer: spin lock %.2fns/item, SPSC %.2fns/item",
+                 lockedSeconds * 1e9 / (double)items,
+                 spscSeconds * 1e9 / (double)items);
+   }
+   {
+      ctMPMCQueue<uint64_t> mpmc;
+      mpmc.Reserve(1024);
+      queue_test_locked<uint64_t> locked(1024);
+      const double lockedSeconds = queue_test_run(locked, 4, 4, items / 4);
+      const double mpmcSeconds = queue_test_run(mpmc, 4, 4, items / 4);
+      ctDebugLog("4 producers 4 consumers: spin lock %.2fns/item, MPMC %.2fns/item",
+                 lockedSeconds * 1e9 / (double)items,
+                 mpmcSeconds * 1e9 / (double)items);
+   }
+}
@@ -18,7 +18,8 @@
 #include "utilities/SpacialQuery.hpp"
 #include "utilities/BloomFilter.hpp"
 #include "utilities/SpacialQuery.hpp"
-#include "utilities/HandledList.hpp"
+#include "utilities/SlotMap.hpp"
+#include "utilities/RingBuffer.hpp"
 #include "utilities/GUID.hpp"
 #include "utilities/Noise.hpp"
 #include "system/System.h"
@@ -33,6 +34,51 @@ int life_notifier_comp(const int* A, const int* B) {
    return *A - *B;
 }
 
+/* Counts every way a value comes to life or goes away */
+struct lifetime_counts {
+   int constructed;
+   int copied;
+   int moved;
+   int assigned;
+   int destroyed;
+};
+static lifetime_counts gLifetime;
+
+struct lifetime_item {
+   lifetime_item() {
+      gLifetime.constructed++;
+      payload = 0;
+   }
+   lifetime_item(int value) {
+      gLifetime.constructed++;
+      payload = value;
+   }
+   lifetime_item(const lifetime_item& other) {
+      gLifetime.copied++;
+      payload = other.payload;
+   }
+   lifetime_item(lifetime_item&& other) {
+      gLifetime.moved++;
+      payload = other.payload;
+      other.payload = -1;
+   }
+   lifetime_item& operator=(const lifetime_item& other) {
+      gLifetime.assigned++;
+      payload = other.payload;
+      return *this;
+   }
+   lifetime_item& operator=(lifetime_item&& other) {
+      gLifetime.assigned++;
+      payload = other.payload;
+      other.payload = -1;
+      return *this;
+   }
+   ~lifetime_item() {
+      gLifetime.destroyed++;
+   }
+   int payload;
+};
+
 void array_test(void) {
    ZoneScoped;
    {
@@ -123,6 +169,188 @@ void array_test(void) {
    }
 }
 
+void array_lifetime_test(void) {
+   ZoneScoped;
+   TEST_CHECK(ctIsTriviallyRelocatable<ctVec3>::value);
+   TEST_CHECK(ctIsTriviallyRelocatable<ctStringUtf8>::value);
+   TEST_CHECK(!ctIsTriviallyRelocatable<lifetime_item>::value);
+   memset(&gLifetime, 0, sizeof(gLifetime));
+   {
+      ctDynamicArray<lifetime_item> arr;
+      /* spare capacity is never constructed */
+      arr.SetGrowthStep(4);
+      arr.Append(lifetime_item(0));
+      TEST_CHECK(arr.Capacity() == 4);
+      arr.Reserve(64);
+      TEST_CHECK(gLifetime.constructed == 1);
+      TEST_CHECK(gLifetime.moved == 2);
+
+      /* growth moves, emplace constructs in place */
+      for (int i = 1; i < 64; i++) {
+         arr.EmplaceBack(i);
+      }
+      TEST_CHECK(gLifetime.constructed == 64);
+      TEST_CHECK(gLifetime.moved == 2);
+      arr.EmplaceBack(64);
+      TEST_CHECK(arr.Capacity() == 68);
+      TEST_CHECK(gLifetime.moved == 66);
+      TEST_CHECK(gLifetime.copied == 0);
+
+      /* appending an element of a full array to itself */
+      arr.Resize(68);
+      arr.Append(arr[10]);
+      TEST_CHECK(arr.Count() == 69 && arr.Last().payload == 10);
+
+      /* shifting keeps order and destroys what leaves the array */
+      arr.Insert(lifetime_item(-5), 2);
+      TEST_CHECK(arr[2].payload == -5 && arr[3].payload == 2);
+      arr.RemoveAt(2);
+      TEST_CHECK(arr[2].payload == 2 && arr.Count() == 69);
+      arr.Resize(10);
+      TEST_CHECK(arr.Count() == 10 && arr.Last().payload == 9);
+      arr.Clear();
+      TEST_CHECK(gLifetime.constructed + gLifetime.copied + gLifetime.moved ==
+                 gLifetime.destroyed);
+   }
+   /* relocatable elements are memcpy'd on growth and memmove'd when shifting */
+   {
+      ctDynamicArray<ctStringUtf8> strings;
+      for (int i = 0; i < 100; i++) {
+         ctStringUtf8 str;
+         str.Printf(32, "String %d", i);
+         strings.Append(ctMove(str));
+      }
+      strings.Insert(ctStringUtf8("Inserted"), 50);
+      strings.RemoveAt(10);
+      TEST_CHECK(strings.Count() == 100);
+      TEST_CHECK(strings[9] == "String 9");
+      TEST_CHECK(strings[10] == "String 11");
+      TEST_CHECK(strings[49] == "Inserted");
+      TEST_CHECK(strings[99] == "String 99");
+      ctDynamicArray<ctStringUtf8> copy = strings;
+      strings.Clear();
+      TEST_CHECK(copy[49] == "Inserted");
+   }
+}
+
+void ring_buffer_test(void) {
+   ZoneScoped;
+   /* wrapped contents survive growth in order */
+   {
+      ctRingBuffer<int> ring;
+      ring.Reserve(16);
+      for (int i = 0; i < 12; i++) {
+         ring.Append(i);
+      }
+      for (int i = 0; i < 10; i++) {
+         ring.RemoveFirst();
+      }
+      for (int i = 12; i < 100; i++) {
+         ring.Append(i);
+      }
+      TEST_CHECK(ring.Capacity() == 128);
+      bool ordered = ring.Count() == 90;
+      for (size_t i = 0; i < ring.Count(); i++) {
+         ordered &= ring[i] == (int)i + 10;
+      }
+      TEST_CHECK(ordered);
+      TEST_CHECK(ring.First() == 10 && ring.Last() == 99);
+   }
+   /* both ends */
+   {
+      ctRingBuffer<int> ring;
+      for (int i = 1; i <= 40; i++) {
+         ring.Append(i);
+         ring.Prepend(-i);
+      }
+      TEST_CHECK(ring.Count() == 80);
+      TEST_CHECK(ring.First() == -40 && ring.Last() == 40);
+      int value = 0;
+      TEST_CHECK(ring.PopFront(value) && value == -40);
+      TEST_CHECK(ring.PopBack(value) && value == 40);
+      ring.RemoveLast();
+      TEST_CHECK(ring.Last() == 38);
+      ctRingBuffer<int> copy = ring;
+      ring.Clear();
+      TEST_CHECK(ring.isEmpty() && !ring.PopFront(value));
+      TEST_CHECK(copy.Count() == 77 && copy[38] == -1 && copy[39] == 1);
+   }
+   /* only live elements are constructed and each is destroyed once */
+   memset(&gLifetime, 0, sizeof(gLifetime));
+   {
+      ctRingBuffer<lifetime_item> ring;
+      ring.Reserve(8);
+      TEST_CHECK(gLifetime.constructed == 0);
+      for (int i = 0; i < 1000; i++) {
+         ring.Append(lifetime_item(i));
+         if (i % 3 == 0) { ring.RemoveFirst(); }
+      }
+      lifetime_item item;
+      TEST_CHECK(ring.PopFront(item) && item.payload == 334);
+      ring.Prepend(item);
+      TEST_CHECK(ring.First().payload == 334);
+   }
+   TEST_CHECK(gLifetime.constructed + gLifetime.copied + gLifetime.moved ==
+              gLifetime.destroyed);
+}
+
+struct ring_buffer_benchmark_job {
+   void* pFunction;
+   void* pData;
+   uint64_t payload[6];
+};
+
+/* The array backed queue ctRingBuffer replaced, every pop shifts the rest down */
+struct ring_buffer_legacy {
+   ctResults Append(const ring_buffer_benchmark_job& job) {
+      return storage.Append(job);
+   }
+   bool PopFront(ring_buffer_benchmark_job& out) {
+      if (storage.isEmpty()) { return false; }
+      out = storage.First();
+      storage.RemoveFirst();
+      return true;
+   }
+   ctDynamicArray<ring_buffer_benchmark_job> storage;
+};
+
+template<class Queue>
+static void ring_buffer_benchmark_run(const char* name, Queue& queue, size_t depth) {
+   const size_t pairs = 200000;
+   ring_buffer_benchmark_job job = {};
+   for (size_t i = 0; i < depth; i++) {
+      job.payload[0] = i;
+      queue.Append(job);
+   }
+   ctStopwatch timer = ctStopwatch();
+   uint64_t sum = 0;
+   for (size_t i = 0; i < pairs; i++) {
+      ring_buffer_benchmark_job out;
+      queue.PopFront(out);
+      sum += out.payload[0];
+      job.payload[0] = depth + i;
+      queue.Append(job);
+   }
+   timer.NextLap();
+   /* popped every value from 0 to pairs - 1 in order */
+   TEST_CHECK(sum == (uint64_t)pairs * (pairs - 1) / 2);
+   ctDebugLog("%s (depth %d): %.2fns per push/pop",
+              name,
+              (int)depth,
+              timer.GetDeltaTime() * 1e9 / (double)pairs);
+}
+
+void ring_buffer_benchmark_test(void) {
+   ZoneScoped;
+   const size_t depths[] = {16, 256, 2048};
+   for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+      ring_buffer_legacy legacy;
+      ring_buffer_benchmark_run("Shifting array", legacy, depths[i]);
+      ctRingBuffer<ring_buffer_benchmark_job> ring;
+      ring_buffer_benchmark_run("Ring buffer", ring, depths[i]);
+   }
+}
+
 void dynamic_string_test(void) {
    ZoneScoped;
    ctStringUtf8 mystring = ctStringUtf8("Hello world!");
@@ -246,6 +474,234 @@ void hash_table_test(void) {
    }*/
 }
 
+void hash_table_tombstone_test(void) {
+   ZoneScoped;
+   /* removing keys in the middle of a probe chain can't hide the ones after it */
+   {
+      ctHashTable<uint32_t, uint32_t> hashTable;
+      for (uint32_t i = 1; i <= 20000; i++) {
+         hashTable.Insert(i, i * 3);
+      }
+      for (uint32_t i = 1; i <= 20000; i += 2) {
+         hashTable.Remove(i);
+      }
+      TEST_CHECK(hashTable.Count() == 10000);
+      bool found = true;
+      for (uint32_t i = 1; i <= 20000; i++) {
+         uint32_t* pValue = hashTable.FindPtr(i);
+         if (i % 2) {
+            found &= pValue == NULL;
+         } else {
+            found &= pValue && *pValue == i * 3;
+         }
+      }
+      TEST_CHECK(found);
+      size_t iterated = 0;
+      for (auto itt = hashTable.GetIterator(); itt; itt++) {
+         TEST_CHECK(itt.Key() % 2 == 0 && itt.Value() == itt.Key() * 3);
+         iterated++;
+      }
+      TEST_CHECK(iterated == 10000);
+   }
+   /* churn through tombstones without growing forever */
+   {
+      ctHashTable<uint32_t, uint32_t> hashTable;
+      hashTable.Reserve(1000);
+      const size_t capacity = hashTable.Capacity();
+      for (uint32_t i = 1; i <= 200000; i++) {
+         hashTable.Insert(i, i);
+         if (i > 500) { hashTable.Remove(i - 500); }
+      }
+      TEST_CHECK(hashTable.Count() == 500);
+      TEST_CHECK(hashTable.Capacity() == capacity);
+      TEST_CHECK(hashTable.FindPtr(200000 - 499) != NULL);
+      TEST_CHECK(hashTable.FindPtr(200000 - 500) == NULL);
+   }
+   /* duplicates are reachable by occurance and removed one at a time */
+   {
+      ctHashTable<int, uint64_t> hashTable;
+      for (int i = 0; i < 40; i++) {
+         hashTable.Insert(0xBEEF, i);
+         hashTable.Insert((uint64_t)i + 1, -i);
+      }
+      TEST_CHECK(hashTable.FindPtr(0xBEEF, 39) != NULL);
+      TEST_CHECK(hashTable.FindPtr(0xBEEF, 40) == NULL);
+      hashTable.Remove(0xBEEF);
+      TEST_CHECK(hashTable.FindPtr(0xBEEF, 38) != NULL);
+      TEST_CHECK(hashTable.FindPtr(0xBEEF, 39) == NULL);
+      ctHashTable<int, uint64_t> copy = hashTable;
+      TEST_CHECK(copy.Count() == 79);
+      TEST_CHECK(copy.FindPtr(0xBEEF, 38) != NULL);
+      copy.Clear();
+      TEST_CHECK(copy.isEmpty() && !copy.Exists(0xBEEF));
+   }
+}
+
+void hash_table_lifetime_test(void) {
+   ZoneScoped;
+   memset(&gLifetime, 0, sizeof(gLifetime));
+   {
+      ctHashTable<lifetime_item, uint32_t> hashTable;
+      /* empty slots are never constructed */
+      hashTable.Reserve(1000);
+      TEST_CHECK(gLifetime.constructed == 0);
+      TEST_CHECK(gLifetime.destroyed == 0);
+
+      /* temporaries are moved in, named values copied */
+      for (int i = 1; i <= 100; i++) {
+         hashTable.Insert((uint32_t)i, lifetime_item(i));
+      }
+      TEST_CHECK(gLifetime.constructed == 100);
+      TEST_CHECK(gLifetime.moved == 100);
+      TEST_CHECK(gLifetime.copied == 0);
+      lifetime_item named(101);
+      hashTable.Insert(101, named);
+      TEST_CHECK(gLifetime.copied == 1);
+
+      /* growth moves the live values over and destroys the old ones */
+      const int movedBefore = gLifetime.moved;
+      const int destroyedBefore = gLifetime.destroyed;
+      for (int i = 102; i <= 3000; i++) {
+         hashTable.Insert((uint32_t)i, lifetime_item(i));
+      }
+      const int growthMoves = gLifetime.moved - movedBefore - 2899;
+      TEST_CHECK(growthMoves > 0);
+      TEST_CHECK(gLifetime.copied == 1);
+      TEST_CHECK(gLifetime.destroyed - destroyedBefore == 2899 + growthMoves);
+      TEST_CHECK(hashTable.FindPtr(77)->payload == 77);
+      TEST_CHECK(hashTable.FindPtr(2999)->payload == 2999);
+
+      /* remove and clear destroy exactly the live values */
+      int destroyed = gLifetime.destroyed;
+      hashTable.Remove(77);
+      TEST_CHECK(gLifetime.destroyed == destroyed + 1);
+      hashTable.Remove(77);
+      TEST_CHECK(gLifetime.destroyed == destroyed + 1);
+      hashTable.Clear();
+      TEST_CHECK(gLifetime.destroyed == destroyed + 3000);
+      hashTable.Insert(5, lifetime_item(5));
+      hashTable.InsertOrReplace(5, lifetime_item(6));
+      TEST_CHECK(hashTable.FindPtr(5)->payload == 6);
+      TEST_CHECK(gLifetime.assigned == 1);
+   }
+   /* every value that was made was destroyed once */
+   TEST_CHECK(gLifetime.constructed + gLifetime.copied +
+                gLifetime.moved ==
+              gLifetime.destroyed);
+}
+
+/* The linear probing table this replaced, keys modulo a prime */
+struct hash_table_legacy {
+   hash_table_legacy(size_t baseSize) {
+      capacity = ctNextPrime(baseSize * 100 / 70);
+      pKeys = (uint32_t*)ctMalloc(sizeof(uint32_t) * capacity);
+      pValues = (uint32_t*)ctMalloc(sizeof(uint32_t) * capacity);
+      memset(pKeys, 0, sizeof(uint32_t) * capacity);
+   }
+   ~hash_table_legacy() {
+      ctFree(pKeys);
+      ctFree(pValues);
+   }
+   void Insert(uint32_t key, uint32_t value) {
+      size_t idx = key % capacity;
+      while (pKeys[idx] != 0) {
+         idx = (idx + 1) % capacity;
+      }
+      pKeys[idx] = key;
+      pValues[idx] = value;
+   }
+   uint32_t* FindPtr(uint32_t key) {
+      size_t idx = key % capacity;
+      for (size_t attempt = 0; attempt < capacity; attempt++) {
+         if (pKeys[idx] == key) { return &pValues[idx]; }
+         idx = (idx + 1) % capacity;
+      }
+      return NULL;
+   }
+   void Remove(uint32_t key) {
+      uint32_t* pValue = FindPtr(key);
+      if (pValue) { pKeys[pValue - pValues] = 0; }
+   }
+   size_t capacity;
+   uint32_t* pKeys;
+   uint32_t* pValues;
+};
+
+template<class Table>
+static size_t hash_table_benchmark_run(const char* name,
+                                     Table& table,
+                                     const uint32_t* pKeys,
+                                     size_t count) {
+   ctStopwatch timer = ctStopwatch();
+   for (size_t i = 0; i < count; i++) {
+      table.Insert(pKeys[i], (uint32_t)i);
+   }
+   timer.NextLap();
+   const double insertSeconds = timer.GetDeltaTime();
+   size_t hits = 0;
+   for (size_t i = 0; i < count; i++) {
+      hits += table.FindPtr(pKeys[i]) != NULL;
+   }
+   timer.NextLap();
+   const double hitSeconds = timer.GetDeltaTime();
+   /* keys from the other half of the buffer were never inserted
+    (a small sample, the linear probe has to walk the whole table to miss) */
+   const size_t missCount = count / 100;
+   size_t misses = 0;
+   for (size_t i = 0; i < missCount; i++) {
+      misses += table.FindPtr(pKeys[count + i]) == NULL;
+   }
+   timer.NextLap();
+   const double missSeconds = timer.GetDeltaTime();
+   for (size_t i = 0; i < count; i += 2) {
+      table.Remove(pKeys[i]);
+   }
+   timer.NextLap();
+   const double removeSeconds = timer.GetDeltaTime();
+   TEST_CHECK(hits == count);
+   ctDebugLog("%s: insert %.2fns, hit %.2fns, miss %.2fns, remove %.2fns",
+              name,
+              insertSeconds * 1e9 / (double)count,
+              hitSeconds * 1e9 / (double)count,
+              missSeconds * 1e9 / (double)missCount,
+              removeSeconds * 2e9 / (double)count);
+   return misses;
+}
+
+void hash_table_benchmark_test(void) {
+   ZoneScoped;
+   const size_t count = 200000;
+   uint32_t* pKeys = (uint32_t*)ctMalloc(sizeof(uint32_t) * count * 2);
+   /* sequential handles: a slot index in the low bits and a generation above */
+   for (size_t i = 0; i < count * 2; i++) {
+      pKeys[i] = (uint32_t)((i + 1) | (1u << 24));
+   }
+   {
+      hash_table_legacy legacy(count);
+      TEST_CHECK(hash_table_benchmark_run(
+                   "Linear probe (handles)", legacy, pKeys, count) == count / 100);
+      ctHashTable<uint32_t, uint32_t> table;
+      table.Reserve(count);
+      TEST_CHECK(hash_table_benchmark_run(
+                   "Group probe (handles)", table, pKeys, count) == count / 100);
+   }
+   /* hashed names (a few collide, both tables must agree on them) */
+   for (size_t i = 0; i < count * 2; i++) {
+      const uint32_t seed = (uint32_t)i;
+      pKeys[i] = XXH32(&seed, sizeof(seed), 0) | 1;
+   }
+   {
+      hash_table_legacy legacy(count);
+      const size_t legacyMisses =
+        hash_table_benchmark_run("Linear probe (hashes)", legacy, pKeys, count);
+      ctHashTable<uint32_t, uint32_t> table;
+      table.Reserve(count);
+      TEST_CHECK(hash_table_benchmark_run("Group probe (hashes)", table, pKeys, count) ==
+                 legacyMisses);
+   }
+   ctFree(pKeys);
+}
+
 void json_test(void) {
    ZoneScoped;
    ctJSONWriter jsonOut;
@@ -409,25 +865,114 @@ void handle_ptr_test(void) {
 void math_3d_test(void) {
 }
 
-void handled_list_test(void) {
+void slot_map_test(void) {
+   ZoneScoped;
+   {
+      ctDynamicArray<ctHandle> handles;
+      ctSlotMap<int> map;
+      const int count = 128;
+      for (int i = 0; i < count; i++) {
+         handles.Append(map.Insert(i));
+      }
+      TEST_CHECK(!map.Exists(0));
+      TEST_CHECK(map.Count() == count);
+      bool resolved = true;
+      for (int i = 0; i < count; i++) {
+         resolved &= map[handles[i]] == i;
+      }
+      TEST_CHECK(resolved);
+
+      /* removing swaps the last item in, other handles keep resolving */
+      for (int i = 0; i < count; i += 2) {
+         TEST_CHECK(map.Remove(handles[i]) == CT_SUCCESS);
+      }
+      TEST_CHECK(map.Remove(handles[0]) == CT_FAILURE_DATA_DOES_NOT_EXIST);
+      TEST_CHECK(map.Count() == count / 2);
+      resolved = true;
+      for (int i = 0; i < count; i++) {
+         resolved &= (map.Get(handles[i]) != NULL) == (i % 2 == 1);
+         if (i % 2) { resolved &= map[handles[i]] == i; }
+      }
+      TEST_CHECK(resolved);
+
+      /* dense iteration sees every live item once */
+      int sum = 0;
+      bool mapped = true;
+      for (size_t i = 0; i < map.Count(); i++) {
+         sum += map.Data()[i];
+         mapped &= map[map.GetHandleAt(i)] == map.Data()[i];
+      }
+      TEST_CHECK(sum == (count / 2) * (count / 2));
+      TEST_CHECK(mapped);
+
+      /* reused slots get a new generation, stale handles stay dead */
+      const ctHandle reused = map.Insert(1000);
+      TEST_CHECK(ctHandleGetIndex(reused) == ctHandleGetIndex(handles[count - 2]));
+      TEST_CHECK(reused != handles[count - 2]);
+      TEST_CHECK(!map.Exists(handles[count - 2]));
+      TEST_CHECK(map[reused] == 1000);
+      map.Clear();
+      TEST_CHECK(map.isEmpty() && !map.Exists(reused) && !map.Exists(handles[1]));
+   }
+   /* removed items are destroyed, not just forgotten */
+   memset(&gLifetime, 0, sizeof(gLifetime));
+   {
+      ctSlotMap<lifetime_item> map;
+      ctHandle handles[64];
+      for (int i = 0; i < 64; i++) {
+         handles[i] = map.Emplace(i);
+      }
+      for (int i = 0; i < 64; i += 3) {
+         map.Remove(handles[i]);
+      }
+      TEST_CHECK(gLifetime.destroyed - gLifetime.moved == 22);
+      TEST_CHECK(map[handles[62]].payload == 62 && !map.Exists(handles[63]));
+   }
+   TEST_CHECK(gLifetime.constructed + gLifetime.copied + gLifetime.moved ==
+              gLifetime.destroyed);
+}
+
+void handle_manager_test(void) {
+   ZoneScoped;
+   ctHandleManager manager;
+   /* crosses the first few node chunks */
+   const uint32_t count = 1500;
    ctDynamicArray<ctHandle> handles;
-   ctDynamicArray<int*> pointers;
-   ctHandledList<int> list;
-   const int count = 128;
-   for (int i = 0; i < count; i++) {
-      handles.Append(list.Insert(i));
-      pointers.Append(&list[handles.Last()]);
-   }
-   for (int i = 0; i < count; i++) {
-      ctDebugLog("Handle: %d "
-                 "Pointer: %p "
-                 "Value By Pointer: %d "
-                 "Value By Handle: %d",
-                 handles[i],
-                 pointers[i],
-                 *pointers[i],
-                 list[handles[i]]);
+   for (uint32_t i = 0; i < count; i++) {
+      handles.Append(manager.GetNewHandle());
    }
+   bool sequential = true;
+   for (uint32_t i = 0; i < count; i++) {
+      sequential &= ctHandleGetIndex(handles[i]) == i + 1;
+      sequential &= ctHandleGetGeneration(handles[i]) == 0;
+   }
+   TEST_CHECK(sequential);
+
+   /* freed indices come back last in first out with the next generation */
+   for (uint32_t i = 0; i < count; i += 2) {
+      manager.FreeHandle(handles[i]);
+   }
+   bool reused = true;
+   for (int64_t i = count - 2; i >= 0; i -= 2) {
+      const ctHandle handle = manager.GetNewHandle();
+      reused &= ctHandleGetIndex(handle) == ctHandleGetIndex(handles[(size_t)i]);
+      reused &= ctHandleGetGeneration(handle) == 1;
+   }
+   TEST_CHECK(reused);
+   TEST_CHECK(ctHandleGetIndex(manager.GetNewHandle()) == count + 1);
+
+   /* the generation wraps after 256 reuses */
+   ctHandle handle = handles[7];
+   for (int i = 0; i < 256; i++) {
+      manager.FreeHandle(handle);
+      handle = manager.GetNewHandle();
+   }
+   TEST_CHECK(handle == handles[7]);
+
+   /* clearing drops the free list without handing out old indices again */
+   manager.FreeHandle(handles[3]);
+   manager.Clear();
+   TEST_CHECK(manager.GetNewHandle() == ctHandleMake(count + 2, 0));
 }
 
 void output_direct(const char* text, void* userData) {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "utilities/Common.h"
+#include "utilities/VirtualArray.hpp"
 #include "cgltf/cgltf.h"
 #include "formats/model/Model.hpp"
 #include "tiny_imageFormat/tinyimageformat.h"
@@ -357,16 +358,16 @@ private:
    ctDynamicArray<ctModelMeshMorphTargetMapping> finalMorphMap;
    ctDynamicArray<ctModelMeshMorphTarget> finalMorphs;
 
-   ctDynamicArray<uint32_t> bucketIndices;
-   ctDynamicArray<ctGltf2ModelVertex> bucketVertices;
+   ctVirtualArray<uint32_t> bucketIndices;
+   ctVirtualArray<ctGltf2ModelVertex> bucketVertices;
 
-   /* Compressed Vertex Data */
-   ctDynamicArray<uint16_t> finalIndices;
-   ctDynamicArray<ctModelMeshVertexCoords> finalVertexCoords;
-   ctDynamicArray<ctModelMeshVertexSkinData> finalVertexSkinData;
-   ctDynamicArray<ctModelMeshVertexColor> finalVertexColors;
-   ctDynamicArray<ctModelMeshVertexUV> finalVertexUVs;
-   ctDynamicArray<ctModelMeshVertexMorph> finalVertexMorph;
+   /* Compressed Vertex Data (can reach gigabytes for large levels, grown in place) */
+   ctVirtualArray<uint16_t> finalIndices;
+   ctVirtualArray<ctModelMeshVertexCoords> finalVertexCoords;
+   ctVirtualArray<ctModelMeshVertexSkinData> finalVertexSkinData;
+   ctVirtualArray<ctModelMeshVertexColor> finalVertexColors;
+   ctVirtualArray<ctModelMeshVertexUV> finalVertexUVs;
+   ctVirtualArray<ctModelMeshVertexMorph> finalVertexMorph;
 
    /* Animation */
    ctDynamicArray<ctModelAnimationClip> animClips;